@@ -0,0 +1,61 @@
+// Replaces the global operator new to count allocations. It lives in its own translation unit
+// so that the compiler never sees a matching pair of allocation and deallocation to inline.
+
+#include "alloc-counter.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> g_allocations{0};
+
+void*
+operator new(std::size_t size)
+{
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if(void* ptr = std::malloc(size > 0 ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void*
+operator new[](std::size_t size)
+{
+  return operator new(size);
+}
+
+void
+operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void
+operator delete[](void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void
+operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+void
+operator delete[](void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+namespace lvs {
+namespace benchmarks {
+
+uint64_t
+GetAllocationCount()
+{
+  return g_allocations.load(std::memory_order_relaxed);
+}
+
+} // namespace benchmarks
+} // namespace lvs
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+namespace lvs {
+namespace benchmarks {
+
+// Number of heap allocations made by the process so far, including those of ndn-cxx.
+// Counted by the replacement operator new in alloc-counter.cpp.
+uint64_t GetAllocationCount();
+
+} // namespace benchmarks
+} // namespace lvs
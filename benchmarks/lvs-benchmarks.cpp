@@ -0,0 +1,415 @@
+// lvs-benchmarks measures the hot paths of lvs-cxx: parsing a schema, matching and checking names,
+// user function constraints, and validating Data end to end against an in-memory face.
+// Each benchmark reports ns/op, heap allocations/op and latency percentiles.
+// Use --format json or csv to keep the results of a run and compare them with another.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <boost/asio/io_service.hpp>
+#include <boost/program_options.hpp>
+#include <ndn-cxx/security/key-chain.hpp>
+#include <ndn-cxx/util/dummy-client-face.hpp>
+
+#include "lvs-binary.hpp"
+#include "lvs-checker.hpp"
+#include "lvs-validator.hpp"
+#include "alloc-counter.hpp"
+#include "schemas/check1-compiled.hpp"
+#include "schemas/validator-compiled.hpp"
+
+namespace lvs {
+namespace benchmarks {
+
+namespace po = boost::program_options;
+using namespace ndn::time_literals;
+
+// The schemas of the unit tests, from tests/schemas through the headers lvs-codegen makes of them
+// Schema1 (check1.lvs):
+//   #r1: a/b/c & {c: b, c: a, a: "a"|"x"} <= #r2 | #r3
+//   #r1: a/b/c & {b: "b"|"y"} <= #r2 | #r3
+//   #r2: x/y/z & {x: "xxx"}
+//   #r3: x/y/z & {y: "yyy"}
+// Schema2 (validator.lvs), which is check2.lvs with #data signed by #author_cert instead of #author_key,
+// so that Data validates through a fetched certificate:
+//   #KEY: "KEY"/_/_/_
+//   #root: "example"
+//   #anchor: #root/#KEY
+//   #author_cert: #root/author/#KEY <= #anchor
+//   #data: #root/author/_/_ <= #author_cert
+//   #author_key: #root/author/"KEY"/_
+using Schema1 = schemas::check1::Schema;
+using Schema2 = schemas::validator::Schema;
+
+// Argument of the user function added to Schema1 by UserFnModel()
+static const std::uint8_t FN_ARG[] = {0x08, 0x01, 0x61};
+
+// Keeps results alive so the compiler cannot drop the work
+static volatile size_t g_sink = 0;
+
+struct Result {
+  std::string name;
+  uint64_t iterations;
+  double nsPerOp;
+  double allocsPerOp;
+  double p50;
+  double p90;
+  double p99;
+  double max;
+};
+
+// Runner times each operation separately, so the percentiles include the cost of reading the clock.
+class Runner {
+public:
+  Runner(std::chrono::milliseconds minTime, uint64_t maxIterations, const std::string& filter):
+    m_minTime(minTime), m_maxIterations(maxIterations), m_filter(filter)
+  {
+  }
+
+  void
+  run(const std::string& name, const std::function<void()>& op)
+  {
+    if(!m_filter.empty() && name.find(m_filter) == std::string::npos) {
+      return;
+    }
+    for(int i = 0; i < 16; i ++) {
+      op();
+    }
+
+    std::vector<double> samples;
+    samples.reserve(std::min<uint64_t>(m_maxIterations, 1 << 20));
+    uint64_t allocations = 0;
+    double total = 0;
+    auto deadline = std::chrono::steady_clock::now() + m_minTime;
+    while(samples.size() < m_maxIterations && std::chrono::steady_clock::now() < deadline) {
+      auto allocBefore = GetAllocationCount();
+      auto start = std::chrono::steady_clock::now();
+      op();
+      auto end = std::chrono::steady_clock::now();
+      allocations += GetAllocationCount() - allocBefore;
+      double ns = std::chrono::duration<double, std::nano>(end - start).count();
+      samples.push_back(ns);
+      total += ns;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double p) {
+      return samples[std::min(samples.size() - 1, size_t(p * samples.size()))];
+    };
+    auto n = double(samples.size());
+    m_results.push_back(Result{name, samples.size(), total / n, allocations / n,
+                               percentile(0.5), percentile(0.9), percentile(0.99), samples.back()});
+  }
+
+  const std::vector<Result>&
+  getResults() const
+  {
+    return m_results;
+  }
+
+private:
+  std::chrono::milliseconds m_minTime;
+  uint64_t m_maxIterations;
+  std::string m_filter;
+  std::vector<Result> m_results;
+};
+
+static void
+PrintText(std::ostream& os, const std::vector<Result>& results)
+{
+  os << std::left << std::setw(32) << "benchmark" << std::right
+     << std::setw(12) << "iterations" << std::setw(12) << "ns/op" << std::setw(12) << "allocs/op"
+     << std::setw(12) << "p50 ns" << std::setw(12) << "p90 ns" << std::setw(12) << "p99 ns"
+     << std::setw(12) << "max ns" << "\n";
+  os << std::fixed << std::setprecision(1);
+  for(auto&& r: results) {
+    os << std::left << std::setw(32) << r.name << std::right
+       << std::setw(12) << r.iterations << std::setw(12) << r.nsPerOp << std::setw(12) << r.allocsPerOp
+       << std::setw(12) << r.p50 << std::setw(12) << r.p90 << std::setw(12) << r.p99
+       << std::setw(12) << r.max << "\n";
+  }
+}
+
+static void
+PrintCsv(std::ostream& os, const std::vector<Result>& results)
+{
+  os << "benchmark,iterations,ns_per_op,allocs_per_op,p50_ns,p90_ns,p99_ns,max_ns\n";
+  os << std::fixed << std::setprecision(1);
+  for(auto&& r: results) {
+    os << r.name << "," << r.iterations << "," << r.nsPerOp << "," << r.allocsPerOp << ","
+       << r.p50 << "," << r.p90 << "," << r.p99 << "," << r.max << "\n";
+  }
+}
+
+static void
+PrintJson(std::ostream& os, const std::vector<Result>& results)
+{
+  os << std::fixed << std::setprecision(1);
+  os << "{\n  \"benchmarks\": [";
+  for(size_t i = 0; i < results.size(); i ++) {
+    auto& r = results[i];
+    os << (i == 0 ? "\n" : ",\n")
+       << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+       << ", \"ns_per_op\": " << r.nsPerOp << ", \"allocs_per_op\": " << r.allocsPerOp
+       << ", \"p50_ns\": " << r.p50 << ", \"p90_ns\": " << r.p90 << ", \"p99_ns\": " << r.p99
+       << ", \"max_ns\": " << r.max << "}";
+  }
+  os << "\n  ]\n}\n";
+}
+
+// A benchmark that measures the wrong outcome is worse than none
+static void
+Expect(bool result, bool expected, const std::string& what)
+{
+  if(result != expected) {
+    std::cerr << "ERROR: " << what << " returned " << result << std::endl;
+    std::exit(1);
+  }
+}
+
+// Schema1 with a user function constraint $ne(a) on the pattern edge of #r1 that has none,
+// so that a name such as /q/b/c matches only through the user function
+static LvsModel
+UserFnModel()
+{
+  auto model = *LvsModel::Parse(tlv::bstring_view(Schema1::binary, sizeof(Schema1::binary)));
+  ConstraintOption option;
+  option.fn = UserFnCall{"$ne", {UserFnArg{tlv::bstring_view(FN_ARG, sizeof(FN_ARG)), std::nullopt}}};
+  for(auto&& edge: model.nodes[model.start_id].p_edges) {
+    if(edge.cons_sets.empty()) {
+      edge.cons_sets.push_back(PatternConstraint{{option}});
+      break;
+    }
+  }
+  return model;
+}
+
+static void
+RunCheckerBenchmarks(Runner& runner)
+{
+  auto binary1 = tlv::bstring_view(Schema1::binary, sizeof(Schema1::binary));
+  auto binary2 = tlv::bstring_view(Schema2::binary, sizeof(Schema2::binary));
+
+  runner.run("parse/schema1", [&]{
+    g_sink = g_sink + LvsModel::Parse(binary1)->nodes.size();
+  });
+  runner.run("parse/schema2", [&]{
+    g_sink = g_sink + LvsModel::Parse(binary2)->nodes.size();
+  });
+
+  Checker checker1(*LvsModel::Parse(binary1), {});
+  Checker checker2(*LvsModel::Parse(binary2), {});
+  ndn::Name pkt1("/a/b/c"), key1("/xxx/yyy/zzz"), wrongKey1("/yyy/xxx/zzz"), unknown1("/a/b/c/d");
+  ndn::Name pkt2("/example/app/randomData/v=1"), cert2("/example/app/KEY/k/issuer/v=1");
+
+  Expect(checker1.check(pkt1, key1), true, "check/hit");
+  Expect(checker1.check(pkt1, wrongKey1), false, "check/miss-key");
+  Expect(checker1.check(unknown1, key1), false, "check/miss-name");
+  Expect(checker2.check(pkt2, cert2), true, "check/hit-literal");
+
+  runner.run("match/hit", [&]{
+    auto matcher = checker1.match(pkt1);
+    try {
+      while(true) {
+        g_sink = g_sink + std::get<0>(matcher())->size();
+      }
+    } catch(StopIteration&) {
+    }
+  });
+  runner.run("match/miss", [&]{
+    auto matcher = checker1.match(unknown1);
+    try {
+      matcher();
+    } catch(StopIteration&) {
+    }
+  });
+  runner.run("check/hit", [&]{
+    g_sink = g_sink + checker1.check(pkt1, key1);
+  });
+  runner.run("check/miss-key", [&]{
+    g_sink = g_sink + checker1.check(pkt1, wrongKey1);
+  });
+  runner.run("check/miss-name", [&]{
+    g_sink = g_sink + checker1.check(unknown1, key1);
+  });
+  runner.run("check/hit-literal", [&]{
+    g_sink = g_sink + checker2.check(pkt2, cert2);
+  });
+
+  std::map<std::string, UserFn> fns{
+    {"$ne", [](ndn::Name::Component value, const std::vector<ndn::Name::Component>& args) {
+      return args.empty() || value != args[0];
+    }},
+  };
+  Checker checkerFn(UserFnModel(), fns);
+  ndn::Name pktFn("/q/b/c");
+  Expect(checkerFn.check(pktFn, key1), true, "check/user-fn");
+  runner.run("check/user-fn", [&]{
+    g_sink = g_sink + checkerFn.check(pktFn, key1);
+  });
+}
+
+// Validation against a DummyClientFace that answers certificate Interests from memory.
+// The anchor signs the certificate of /example/app, which signs the Data.
+class ValidationBench {
+public:
+  ValidationBench():
+    m_keyChain("pib-memory:", "tpm-memory:"),
+    m_face(m_io, m_keyChain, {false, false})
+  {
+    auto now = ndn::time::system_clock::now();
+    auto anchorId = m_keyChain.createIdentity("/example");
+    m_anchor = anchorId.getDefaultKey().getDefaultCertificate();
+
+    auto appKey = m_keyChain.createIdentity("/example/app").getDefaultKey();
+    m_appCert.setName(ndn::Name(appKey.getName()).append("example").appendVersion());
+    m_appCert.setContentType(ndn::tlv::ContentType_Key);
+    m_appCert.setFreshnessPeriod(1_h);
+    m_appCert.setContent(appKey.getPublicKey());
+    ndn::SignatureInfo info;
+    info.setValidityPeriod(ndn::security::ValidityPeriod(now - 1_day, now + 365_day));
+    m_keyChain.sign(m_appCert, ndn::signingByIdentity(anchorId).setSignatureInfo(info));
+    m_keyChain.addCertificate(appKey, m_appCert);
+
+    m_data.setName("/example/app/randomData/v=1");
+    m_data.setContent(m_appCert.getContent());
+    m_keyChain.sign(m_data, ndn::signingByCertificate(m_appCert));
+
+    m_face.onSendInterest.connect([this](const ndn::Interest& interest) {
+      if(interest.matchesData(m_appCert)) {
+        m_io.post([this]{ m_face.receive(m_appCert); });
+      }
+    });
+  }
+
+  // Validate data and run the face until it is done
+  void
+  validate(Validator& validator, const ndn::Data& data)
+  {
+    bool done = false;
+    validator.validate(data,
+      [&done](const ndn::Data&) {
+        done = true;
+      },
+      [](const ndn::Data& failed, const ndn::security::ValidationError& error) {
+        std::cerr << "ERROR: " << failed.getName() << ": " << error << std::endl;
+        std::exit(1);
+      });
+    while(!done) {
+      m_io.restart();
+      m_io.poll();
+    }
+  }
+
+  void
+  run(Runner& runner)
+  {
+    auto binary = tlv::bstring_view(Schema2::binary, sizeof(Schema2::binary));
+
+    Validator anchorOnly(binary, m_face, m_anchor);
+    runner.run("validate/anchor-signed", [&]{
+      validate(anchorOnly, m_appCert);
+    });
+
+    Validator cached(binary, m_face, m_anchor);
+    runner.run("validate/cached-chain", [&]{
+      validate(cached, m_data);
+    });
+
+    ValidatorOptions noCache;
+    noCache.certCacheCapacity = 0;
+    Validator fetching(binary, m_face, m_anchor, noCache);
+    runner.run("validate/fetch-chain", [&]{
+      validate(fetching, m_data);
+    });
+
+    ValidatorOptions resultCache;
+    resultCache.resultCacheCapacity = 16;
+    Validator remembering(binary, m_face, m_anchor, resultCache);
+    runner.run("validate/result-cache-hit", [&]{
+      validate(remembering, m_data);
+    });
+  }
+
+private:
+  boost::asio::io_service m_io;
+  ndn::KeyChain m_keyChain;
+  ndn::util::DummyClientFace m_face;
+  ndn::security::Certificate m_anchor;
+  ndn::security::Certificate m_appCert;
+  ndn::Data m_data;
+};
+
+static int
+main(int argc, char** argv)
+{
+  std::string filter, format, output;
+  uint64_t minTimeMs = 0, maxIterations = 0;
+
+  po::options_description description(
+    "Usage: lvs-benchmarks [options]\n"
+    "\n"
+    "Options");
+  description.add_options()
+    ("help,h", "print this help message and exit")
+    ("filter,f", po::value<std::string>(&filter), "only run benchmarks whose name contains this")
+    ("min-time,t", po::value<uint64_t>(&minTimeMs)->default_value(500), "milliseconds to run each benchmark")
+    ("max-iterations,n", po::value<uint64_t>(&maxIterations)->default_value(1000000),
+     "maximum number of operations of each benchmark")
+    ("format", po::value<std::string>(&format)->default_value("text"), "text, csv or json")
+    ("output,o", po::value<std::string>(&output), "write results to this file instead of stdout");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, description), vm);
+    po::notify(vm);
+  }
+  catch (const po::error& e) {
+    std::cerr << "ERROR: " << e.what() << "\n\n" << description << std::endl;
+    return 2;
+  }
+  if(vm.count("help")) {
+    std::cout << description << std::endl;
+    return 0;
+  }
+  if(format != "text" && format != "csv" && format != "json") {
+    std::cerr << "ERROR: unknown format " << format << std::endl;
+    return 2;
+  }
+
+  Runner runner(std::chrono::milliseconds(minTimeMs), std::max<uint64_t>(maxIterations, 1), filter);
+  RunCheckerBenchmarks(runner);
+  ValidationBench().run(runner);
+
+  std::ofstream file;
+  if(!output.empty()) {
+    file.open(output);
+    if(!file) {
+      std::cerr << "ERROR: cannot write " << output << std::endl;
+      return 1;
+    }
+  }
+  std::ostream& os = output.empty() ? std::cout : file;
+  if(format == "json") {
+    PrintJson(os, runner.getResults());
+  } else if(format == "csv") {
+    PrintCsv(os, runner.getResults());
+  } else {
+    PrintText(os, runner.getResults());
+  }
+  return 0;
+}
+
+} // namespace benchmarks
+} // namespace lvs
+
+int
+main(int argc, char** argv)
+{
+  return lvs::benchmarks::main(argc, argv);
+}
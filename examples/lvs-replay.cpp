@@ -0,0 +1,550 @@
+// lvs-replay replays a trace of production traffic through a trust schema, to see what a schema
+// change would do before deploying it.
+//
+// The schema and the trace are memory-mapped. The trace is either text, one
+// "<packet name>\t<key name>[\t<1|0>]" line per packet as written by lvs-synth, or a concatenation
+// of wire-encoded Data packets. Records are checked with Checker::check, or, with --validate,
+// by a Validator whose certificates are served from a local file instead of the network.
+//
+// The report gives throughput, a latency histogram, how often each rule accepted a packet,
+// and the records where the decision differs from the expected column or from --reference.
+
+#include <ndn-cxx/data.hpp>
+#include <ndn-cxx/lp/nack.hpp>
+#include <ndn-cxx/security/key-chain.hpp>
+#include <ndn-cxx/util/dummy-client-face.hpp>
+#include <lvs-cxx/lvs-checker.hpp>
+#include <lvs-cxx/lvs-validator.hpp>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace lvs {
+namespace examples {
+
+namespace po = boost::program_options;
+
+// A read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+  explicit
+  MappedFile(const std::string& path)
+  {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("cannot open " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw std::runtime_error("cannot stat " + path);
+    }
+    m_size = size_t(st.st_size);
+    if (m_size > 0) {
+      m_data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+    if (m_data == MAP_FAILED) {
+      throw std::runtime_error("cannot map " + path);
+    }
+  }
+
+  ~MappedFile()
+  {
+    if (m_data != nullptr && m_data != MAP_FAILED) {
+      ::munmap(m_data, m_size);
+    }
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const uint8_t*
+  data() const
+  {
+    return static_cast<const uint8_t*>(m_data);
+  }
+
+  size_t
+  size() const
+  {
+    return m_size;
+  }
+
+  tlv::bstring_view
+  view() const
+  {
+    return {data(), m_size};
+  }
+
+private:
+  void* m_data = nullptr;
+  size_t m_size = 0;
+};
+
+// One packet of the trace, as a range of the mapped file
+struct Record
+{
+  size_t offset;
+  size_t size;
+};
+
+// Reads a TLV-TYPE or TLV-LENGTH, or returns false if the buffer ends first
+static bool
+readVarNumber(const uint8_t*& pos, const uint8_t* end, uint64_t& number)
+{
+  if (pos >= end) {
+    return false;
+  }
+  uint8_t first = *pos++;
+  size_t size = first < 253 ? 0 : first == 253 ? 2 : first == 254 ? 4 : 8;
+  if (size_t(end - pos) < size) {
+    return false;
+  }
+  number = size == 0 ? first : 0;
+  for (size_t i = 0; i < size; i++) {
+    number = (number << 8) | *pos++;
+  }
+  return true;
+}
+
+// Splits the trace into records without copying it
+static std::vector<Record>
+indexTrace(const MappedFile& trace, bool wireFormat)
+{
+  std::vector<Record> records;
+  const uint8_t* begin = trace.data();
+  const uint8_t* end = begin + trace.size();
+  const uint8_t* pos = begin;
+  while (pos < end) {
+    if (wireFormat) {
+      const uint8_t* start = pos;
+      uint64_t type = 0, length = 0;
+      if (!readVarNumber(pos, end, type) || !readVarNumber(pos, end, length) ||
+          uint64_t(end - pos) < length) {
+        throw std::runtime_error("truncated Data at offset " + std::to_string(start - begin));
+      }
+      pos += length;
+      records.push_back({size_t(start - begin), size_t(pos - start)});
+    }
+    else {
+      const uint8_t* eol = std::find(pos, end, '\n');
+      if (eol > pos) {
+        records.push_back({size_t(pos - begin), size_t(eol - pos)});
+      }
+      pos = eol + (eol < end ? 1 : 0);
+    }
+  }
+  return records;
+}
+
+// The names of one record, and the decision the trace expects if it has one
+struct Packet
+{
+  std::optional<ndn::Data> data;
+  ndn::Name name;
+  ndn::Name keyName;
+  std::optional<bool> expected;
+};
+
+static Packet
+parseRecord(const MappedFile& trace, const Record& record, bool wireFormat)
+{
+  Packet packet;
+  const uint8_t* start = trace.data() + record.offset;
+  if (wireFormat) {
+    packet.data.emplace(ndn::Block(ndn::make_span(start, record.size)));
+    packet.name = packet.data->getName();
+    if (auto keyLocator = packet.data->getKeyLocator()) {
+      packet.keyName = keyLocator->getName();
+    }
+    return packet;
+  }
+
+  std::string_view line(reinterpret_cast<const char*>(start), record.size);
+  auto tab = line.find('\t');
+  if (tab == std::string_view::npos) {
+    throw std::runtime_error("no key name in line: " + std::string(line));
+  }
+  packet.name = ndn::Name(std::string(line.substr(0, tab)));
+  auto rest = line.substr(tab + 1);
+  auto tab2 = rest.find('\t');
+  packet.keyName = ndn::Name(std::string(rest.substr(0, tab2)));
+  if (tab2 != std::string_view::npos) {
+    packet.expected = rest.substr(tab2 + 1, 1) == "1";
+  }
+  return packet;
+}
+
+// Decides records with one schema, either by its Checker or by a Validator on a DummyClientFace
+class Decider
+{
+public:
+  Decider(const tlv::bstring_view& schema, const ndn::security::Certificate* anchor,
+          const std::map<ndn::Name, ndn::security::Certificate>& certs)
+    : m_checker(*LvsModel::Parse(schema), {})
+    , m_certs(certs)
+  {
+    if (anchor == nullptr) {
+      return;
+    }
+    m_keyChain = std::make_unique<ndn::KeyChain>("pib-memory:", "tpm-memory:");
+    m_face = std::make_unique<ndn::util::DummyClientFace>(m_io, *m_keyChain,
+                                                          ndn::util::DummyClientFace::Options{false, false});
+    m_face->onSendInterest.connect([this] (const ndn::Interest& interest) {
+      auto cert = m_certs.lower_bound(interest.getName());
+      if (cert != m_certs.end() && interest.getName().isPrefixOf(cert->first)) {
+        m_io.post([this, cert] { m_face->receive(cert->second); });
+      }
+      else {
+        m_io.post([this, interest] {
+          m_face->receive(ndn::lp::Nack(interest).setReason(ndn::lp::NackReason::NO_ROUTE));
+        });
+      }
+    });
+    m_validator = std::make_unique<Validator>(schema, *m_face, *anchor);
+  }
+
+  bool
+  decide(const Packet& packet)
+  {
+    if (m_validator == nullptr || !packet.data.has_value()) {
+      return m_checker.check(packet.name, packet.keyName);
+    }
+    std::optional<bool> result;
+    m_validator->validate(*packet.data,
+                          [&result] (const ndn::Data&) { result = true; },
+                          [&result] (const ndn::Data&, const ndn::security::ValidationError&) {
+                            result = false;
+                          });
+    while (!result.has_value()) {
+      m_io.restart();
+      m_io.run_one();
+    }
+    return *result;
+  }
+
+  // The rule whose signing constraint accepted packet.keyName, for the hit distribution.
+  // check() stops at the accepting sign_cons, so it is the last event explain() records.
+  std::string
+  ruleOf(const Packet& packet)
+  {
+    constexpr size_t MAX_EVENTS = 4096;
+    auto explanation = m_checker.explain(packet.name, packet.keyName, MAX_EVENTS);
+    if (explanation.result && explanation.dropped == 0 && !explanation.events.empty()) {
+      const auto& event = explanation.events.back();
+      if (event.kind == ExplainEvent::SIGN_CONS && event.ok) {
+        auto rules = explanation.rule_names.find(event.node);
+        if (rules != explanation.rule_names.end() && !rules->second.empty()) {
+          return rules->second.front();
+        }
+      }
+    }
+    return "(no rule)";
+  }
+
+private:
+  Checker m_checker;
+  const std::map<ndn::Name, ndn::security::Certificate>& m_certs;
+  boost::asio::io_service m_io;
+  std::unique_ptr<ndn::KeyChain> m_keyChain;
+  std::unique_ptr<ndn::util::DummyClientFace> m_face;
+  std::unique_ptr<Validator> m_validator;
+};
+
+// What the threads found; each thread fills its own and they are merged at the end
+struct Report
+{
+  static constexpr size_t BUCKETS = 40;  // Bucket i holds latencies in [2^i, 2^(i+1)) ns
+
+  uint64_t records = 0;
+  uint64_t accepted = 0;
+  uint64_t errors = 0;
+  uint64_t unexpected = 0;
+  uint64_t newlyAccepted = 0;
+  uint64_t newlyRejected = 0;
+  std::array<uint64_t, BUCKETS> histogram{};
+  std::map<std::string, uint64_t> ruleHits;
+  std::vector<std::string> diffs;
+
+  void
+  merge(const Report& other)
+  {
+    records += other.records;
+    accepted += other.accepted;
+    errors += other.errors;
+    unexpected += other.unexpected;
+    newlyAccepted += other.newlyAccepted;
+    newlyRejected += other.newlyRejected;
+    for (size_t i = 0; i < BUCKETS; i++) {
+      histogram[i] += other.histogram[i];
+    }
+    for (auto&& [rule, hits] : other.ruleHits) {
+      ruleHits[rule] += hits;
+    }
+    diffs.insert(diffs.end(), other.diffs.begin(), other.diffs.end());
+  }
+
+  // Upper bound of the bucket holding the p-th quantile
+  uint64_t
+  percentile(double p) const
+  {
+    uint64_t total = std::accumulate(histogram.begin(), histogram.end(), uint64_t(0));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+      seen += histogram[i];
+      if (total > 0 && seen >= p * total) {
+        return uint64_t(1) << (i + 1);
+      }
+    }
+    return uint64_t(1) << BUCKETS;
+  }
+};
+
+static void
+printReport(const Report& report, double seconds, bool hasReference)
+{
+  std::cout << "records:    " << report.records << "\n"
+            << "accepted:   " << report.accepted << "\n"
+            << "errors:     " << report.errors << "\n"
+            << "throughput: " << std::fixed << std::setprecision(0)
+            << report.records / std::max(seconds, 1e-9) << " records/s over "
+            << std::setprecision(3) << seconds << " s\n"
+            << "latency:    p50 < " << report.percentile(0.5) << " ns, p90 < " << report.percentile(0.9)
+            << " ns, p99 < " << report.percentile(0.99) << " ns\n"
+            << "unexpected: " << report.unexpected << " (against the expected column of the trace)\n";
+  if (hasReference) {
+    std::cout << "reference:  " << report.newlyAccepted << " newly accepted, "
+              << report.newlyRejected << " newly rejected\n";
+  }
+
+  std::cout << "\nlatency histogram\n";
+  for (size_t i = 0; i < Report::BUCKETS; i++) {
+    if (report.histogram[i] > 0) {
+      std::cout << "  < " << std::setw(12) << (uint64_t(1) << (i + 1)) << " ns  "
+                << report.histogram[i] << "\n";
+    }
+  }
+
+  std::vector<std::pair<std::string, uint64_t>> rules(report.ruleHits.begin(), report.ruleHits.end());
+  std::sort(rules.begin(), rules.end(), [] (auto&& a, auto&& b) { return a.second > b.second; });
+  std::cout << "\nrule hits\n";
+  for (auto&& [rule, hits] : rules) {
+    std::cout << "  " << std::setw(10) << hits << "  " << rule << "\n";
+  }
+
+  if (!report.diffs.empty()) {
+    std::cout << "\ndecisions that differ\n";
+    for (auto&& diff : report.diffs) {
+      std::cout << "  " << diff << "\n";
+    }
+  }
+}
+
+static std::vector<ndn::security::Certificate>
+loadCertificates(const std::string& path)
+{
+  MappedFile file(path);
+  std::vector<ndn::security::Certificate> certs;
+  for (auto&& record : indexTrace(file, true)) {
+    certs.emplace_back(ndn::Block(ndn::make_span(file.data() + record.offset, record.size)));
+  }
+  return certs;
+}
+
+static int
+main(int argc, char** argv)
+{
+  std::string schemaFile, traceFile, referenceFile, anchorFile, certsFile;
+  size_t nThreads = 1, maxDiffs = 20;
+
+  po::options_description visibleOpts(
+    "Usage: lvs-replay [options] <schema.lvs> <trace>\n"
+    "\n"
+    "Options");
+  visibleOpts.add_options()
+    ("help,h", "print this help message and exit")
+    ("threads,j", po::value<size_t>(&nThreads)->default_value(1), "number of replay threads")
+    ("wire,w", "the trace is wire-encoded Data rather than text name pairs")
+    ("reference,r", po::value<std::string>(&referenceFile), "report decisions that differ from this schema")
+    ("validate", "validate Data with a Validator rather than only checking names; implies --wire")
+    ("anchor", po::value<std::string>(&anchorFile), "trust anchor certificate for --validate, wire-encoded")
+    ("certs", po::value<std::string>(&certsFile), "certificates served to the validator, wire-encoded")
+    ("max-diffs", po::value<size_t>(&maxDiffs)->default_value(20), "largest number of differences to print");
+
+  po::options_description hiddenOpts;
+  hiddenOpts.add_options()
+    ("schema", po::value<std::string>(&schemaFile))
+    ("trace", po::value<std::string>(&traceFile));
+
+  po::positional_options_description posOpts;
+  posOpts.add("schema", 1).add("trace", 1);
+
+  po::options_description allOpts;
+  allOpts.add(visibleOpts).add(hiddenOpts);
+
+  po::variables_map vm;
+  try {
+    po::store(po::command_line_parser(argc, argv).options(allOpts).positional(posOpts).run(), vm);
+    po::notify(vm);
+  }
+  catch (const po::error& e) {
+    std::cerr << "ERROR: " << e.what() << "\n\n" << visibleOpts << std::endl;
+    return 2;
+  }
+  if (vm.count("help")) {
+    std::cout << visibleOpts << std::endl;
+    return 0;
+  }
+  bool validate = vm.count("validate") > 0;
+  bool wireFormat = validate || vm.count("wire") > 0;
+  if (schemaFile.empty() || traceFile.empty() || nThreads == 0 || (validate && anchorFile.empty())) {
+    std::cerr << "ERROR: need a schema, a trace, at least one thread, and an --anchor to --validate\n\n"
+              << visibleOpts << std::endl;
+    return 2;
+  }
+
+  try {
+    MappedFile schema(schemaFile);
+    std::optional<MappedFile> reference;
+    if (!referenceFile.empty()) {
+      reference.emplace(referenceFile);
+    }
+    for (auto* file : {&schema, reference ? &*reference : nullptr}) {
+      if (file != nullptr && !LvsModel::Parse(file->view()).has_value()) {
+        std::cerr << "ERROR: cannot parse the schema" << std::endl;
+        return 1;
+      }
+    }
+
+    std::optional<ndn::security::Certificate> anchor;
+    std::map<ndn::Name, ndn::security::Certificate> certs;
+    if (validate) {
+      anchor = loadCertificates(anchorFile).at(0);
+      if (!certsFile.empty()) {
+        for (auto&& cert : loadCertificates(certsFile)) {
+          certs.emplace(cert.getName(), cert);
+        }
+      }
+    }
+
+    MappedFile trace(traceFile);
+    auto records = indexTrace(trace, wireFormat);
+
+    std::vector<Report> reports(nThreads);
+    std::atomic<size_t> next{0};
+    std::mutex errorMutex;
+    std::string firstError;
+    auto replay = [&] (Report& report) {
+      const auto* anchorPtr = anchor ? &*anchor : nullptr;
+      // A throw would escape the thread and terminate; leave the records to the other threads
+      std::optional<Decider> decider;
+      std::optional<Decider> referenceDecider;
+      try {
+        decider.emplace(schema.view(), anchorPtr, certs);
+        if (reference) {
+          referenceDecider.emplace(reference->view(), anchorPtr, certs);
+        }
+      }
+      catch (const std::exception& e) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (firstError.empty()) {
+          firstError = std::string("setup: ") + e.what();
+        }
+        return;
+      }
+      constexpr size_t BATCH = 256;
+      for (size_t begin; (begin = next.fetch_add(BATCH)) < records.size();) {
+        for (size_t i = begin; i < std::min(begin + BATCH, records.size()); i++) {
+          try {
+            auto packet = parseRecord(trace, records[i], wireFormat);
+            auto start = std::chrono::steady_clock::now();
+            bool accepted = decider->decide(packet);
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start).count();
+            size_t bucket = 0;
+            while (bucket + 1 < Report::BUCKETS && (uint64_t(1) << (bucket + 1)) <= uint64_t(ns)) {
+              bucket++;
+            }
+            report.records++;
+            report.histogram[bucket]++;
+            if (accepted) {
+              report.accepted++;
+              report.ruleHits[decider->ruleOf(packet)]++;
+            }
+            if (packet.expected.has_value() && *packet.expected != accepted) {
+              report.unexpected++;
+            }
+            if (referenceDecider && referenceDecider->decide(packet) != accepted) {
+              (accepted ? report.newlyAccepted : report.newlyRejected)++;
+              if (report.diffs.size() < maxDiffs) {
+                report.diffs.push_back((accepted ? "+ " : "- ") + packet.name.toUri() +
+                                       " " + packet.keyName.toUri());
+              }
+            }
+          }
+          catch (const std::exception& e) {
+            report.errors++;
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (firstError.empty()) {
+              firstError = "record " + std::to_string(i) + ": " + e.what();
+            }
+          }
+        }
+      }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < nThreads; i++) {
+      threads.emplace_back(replay, std::ref(reports[i]));
+    }
+    replay(reports[0]);
+    for (auto&& thread : threads) {
+      thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Report total;
+    for (auto&& report : reports) {
+      total.merge(report);
+    }
+    total.diffs.resize(std::min(total.diffs.size(), maxDiffs));
+    printReport(total, seconds, reference.has_value());
+    if (!firstError.empty()) {
+      std::cerr << "ERROR: " << firstError << std::endl;
+    }
+    return 0;
+  }
+  catch (const std::exception& e) {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    return 1;
+  }
+}
+
+} // namespace examples
+} // namespace lvs
+
+int
+main(int argc, char** argv)
+{
+  return lvs::examples::main(argc, argv);
+}
@@ -0,0 +1,334 @@
+#include "lvs-cert-cache.hpp"
+
+namespace lvs {
+
+CertCache::CertCache(size_t capacity, ndn::time::nanoseconds maxLifetime):
+  m_capacity(capacity), m_maxLifetime(maxLifetime)
+{
+}
+
+void
+CertCache::insert(const ndn::security::Certificate& cert)
+{
+  if(m_capacity == 0){
+    return;
+  }
+  auto now = ndn::time::system_clock::now();
+  auto [notBefore, notAfter] = cert.getValidityPeriod().getPeriod();
+  if(now < notBefore || now >= notAfter){
+    return;
+  }
+  auto expiry = std::min(notAfter, now + m_maxLifetime);
+
+  auto it = m_certs.find(cert.getName());
+  if(it != m_certs.end()){
+    it->second.cert = std::make_shared<const ndn::security::Certificate>(cert);
+    it->second.expiry = expiry;
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+    return;
+  }
+
+  m_lru.push_front(cert.getName());
+  m_certs.emplace(cert.getName(),
+                  Entry{std::make_shared<const ndn::security::Certificate>(cert), expiry, m_lru.begin()});
+  while(m_certs.size() > m_capacity){
+    m_certs.erase(m_lru.back());
+    m_lru.pop_back();
+    m_stats.evictions ++;
+  }
+}
+
+std::shared_ptr<const ndn::security::Certificate>
+CertCache::find(const ndn::Name& keyLocator)
+{
+  auto now = ndn::time::system_clock::now();
+  // Certificates under keyLocator are adjacent in canonical order
+  auto it = m_certs.lower_bound(keyLocator);
+  while(it != m_certs.end() && keyLocator.isPrefixOf(it->first)){
+    if(it->second.expiry <= now){
+      m_lru.erase(it->second.lru);
+      it = m_certs.erase(it);
+      m_stats.expirations ++;
+      continue;
+    }
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+    m_stats.hits ++;
+    return it->second.cert;
+  }
+  m_stats.misses ++;
+  return nullptr;
+}
+
+void
+CertCache::erase(const ndn::Name& certName)
+{
+  auto it = m_certs.find(certName);
+  if(it != m_certs.end()){
+    m_lru.erase(it->second.lru);
+    m_certs.erase(it);
+  }
+}
+
+void
+CertCache::clear()
+{
+  m_certs.clear();
+  m_lru.clear();
+}
+
+NegativeCertCache::NegativeCertCache(size_t capacity):
+  m_capacity(capacity)
+{
+}
+
+void
+NegativeCertCache::insert(const ndn::Name& keyLocator, const ndn::security::ValidationError& error,
+                          ndn::time::nanoseconds ttl)
+{
+  if(m_capacity == 0 || ttl <= ndn::time::nanoseconds::zero()){
+    return;
+  }
+  auto expiry = ndn::time::steady_clock::now() + ttl;
+
+  auto it = m_entries.find(keyLocator);
+  if(it != m_entries.end()){
+    it->second.error = error;
+    it->second.expiry = expiry;
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+    return;
+  }
+
+  m_lru.push_front(keyLocator);
+  m_entries.emplace(keyLocator, Entry{error, expiry, m_lru.begin()});
+  while(m_entries.size() > m_capacity){
+    m_entries.erase(m_lru.back());
+    m_lru.pop_back();
+    m_stats.evictions ++;
+  }
+}
+
+std::optional<ndn::security::ValidationError>
+NegativeCertCache::find(const ndn::Name& keyLocator)
+{
+  auto it = m_entries.find(keyLocator);
+  if(it == m_entries.end()){
+    m_stats.misses ++;
+    return std::nullopt;
+  }
+  if(it->second.expiry <= ndn::time::steady_clock::now()){
+    m_lru.erase(it->second.lru);
+    m_entries.erase(it);
+    m_stats.misses ++;
+    return std::nullopt;
+  }
+  m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+  m_stats.hits ++;
+  return it->second.error;
+}
+
+void
+NegativeCertCache::clear()
+{
+  m_entries.clear();
+  m_lru.clear();
+}
+
+PublicKeyCache::PublicKeyCache(size_t capacity):
+  m_capacity(capacity)
+{
+}
+
+std::shared_ptr<const ndn::security::transform::PublicKey>
+PublicKeyCache::get(const ndn::security::Certificate& cert)
+{
+  auto now = ndn::time::system_clock::now();
+  auto it = m_entries.find(cert.getName());
+  if(it != m_entries.end()){
+    if(now < it->second.expiry){
+      m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+      m_stats.hits ++;
+      return it->second.key;
+    }
+    m_lru.erase(it->second.lru);
+    m_entries.erase(it);
+  }
+  m_stats.misses ++;
+
+  auto key = std::make_shared<ndn::security::transform::PublicKey>();
+  try{
+    key->loadPkcs8(cert.getPublicKey());
+  }catch(ndn::security::transform::PublicKey::Error&){
+    return nullptr;
+  }
+
+  // An expired certificate may still be used, e.g. by the trust anchor, but is not cached
+  auto expiry = cert.getValidityPeriod().getPeriod().second;
+  if(m_capacity == 0 || expiry <= now){
+    return key;
+  }
+  m_lru.push_front(cert.getName());
+  m_entries.emplace(cert.getName(), Entry{key, expiry, m_lru.begin()});
+  while(m_entries.size() > m_capacity){
+    m_entries.erase(m_lru.back());
+    m_lru.pop_back();
+    m_stats.evictions ++;
+  }
+  return key;
+}
+
+void
+PublicKeyCache::erase(const ndn::Name& certName)
+{
+  auto it = m_entries.find(certName);
+  if(it != m_entries.end()){
+    m_lru.erase(it->second.lru);
+    m_entries.erase(it);
+  }
+}
+
+void
+PublicKeyCache::clear()
+{
+  m_entries.clear();
+  m_lru.clear();
+}
+
+ValidationResultCache::ValidationResultCache(size_t capacity):
+  m_capacity(capacity)
+{
+}
+
+void
+ValidationResultCache::insert(const ndn::Name& fullName, ndn::time::system_clock::time_point expiry)
+{
+  if(m_capacity == 0 || expiry <= ndn::time::system_clock::now()){
+    return;
+  }
+
+  auto it = m_entries.find(fullName);
+  if(it != m_entries.end()){
+    it->second.expiry = expiry;
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+    return;
+  }
+
+  m_lru.push_front(fullName);
+  m_entries.emplace(fullName, Entry{expiry, m_lru.begin()});
+  while(m_entries.size() > m_capacity){
+    m_entries.erase(m_lru.back());
+    m_lru.pop_back();
+    m_stats.evictions ++;
+  }
+}
+
+bool
+ValidationResultCache::contains(const ndn::Name& fullName)
+{
+  auto it = m_entries.find(fullName);
+  if(it == m_entries.end()){
+    m_stats.misses ++;
+    return false;
+  }
+  if(it->second.expiry <= ndn::time::system_clock::now()){
+    m_lru.erase(it->second.lru);
+    m_entries.erase(it);
+    m_stats.misses ++;
+    return false;
+  }
+  m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+  m_stats.hits ++;
+  return true;
+}
+
+void
+ValidationResultCache::clear()
+{
+  m_entries.clear();
+  m_lru.clear();
+}
+
+ndn::Name
+keyNameOf(const ndn::Name& keyLocator)
+{
+  if(ndn::security::Certificate::isValidName(keyLocator)){
+    return ndn::security::extractKeyNameFromCertName(keyLocator);
+  }
+  return keyLocator;
+}
+
+ConcurrentCertCache::ConcurrentCertCache(size_t capacity, ndn::time::nanoseconds maxLifetime, size_t stripes)
+{
+  stripes = std::max<size_t>(stripes, 1);
+  // Round up, so that a small nonzero capacity does not disable the cache
+  size_t perStripe = (capacity + stripes - 1) / stripes;
+  for(size_t i = 0; i < stripes; i ++){
+    m_stripes.push_back(std::make_unique<Stripe>(perStripe, maxLifetime));
+  }
+}
+
+ConcurrentCertCache::Stripe&
+ConcurrentCertCache::getStripe(const ndn::Name& keyLocator) const
+{
+  return *m_stripes[std::hash<ndn::Name>()(keyNameOf(keyLocator)) % m_stripes.size()];
+}
+
+void
+ConcurrentCertCache::insert(const ndn::security::Certificate& cert)
+{
+  auto& stripe = getStripe(cert.getName());
+  std::lock_guard<std::mutex> lock(stripe.mutex);
+  stripe.cache.insert(cert);
+}
+
+std::shared_ptr<const ndn::security::Certificate>
+ConcurrentCertCache::find(const ndn::Name& keyLocator)
+{
+  auto& stripe = getStripe(keyLocator);
+  std::lock_guard<std::mutex> lock(stripe.mutex);
+  return stripe.cache.find(keyLocator);
+}
+
+void
+ConcurrentCertCache::erase(const ndn::Name& certName)
+{
+  auto& stripe = getStripe(certName);
+  std::lock_guard<std::mutex> lock(stripe.mutex);
+  stripe.cache.erase(certName);
+}
+
+void
+ConcurrentCertCache::clear()
+{
+  for(auto& stripe: m_stripes){
+    std::lock_guard<std::mutex> lock(stripe->mutex);
+    stripe->cache.clear();
+  }
+}
+
+size_t
+ConcurrentCertCache::size() const
+{
+  size_t ret = 0;
+  for(auto& stripe: m_stripes){
+    std::lock_guard<std::mutex> lock(stripe->mutex);
+    ret += stripe->cache.size();
+  }
+  return ret;
+}
+
+CertCache::Stats
+ConcurrentCertCache::getStats() const
+{
+  CertCache::Stats ret;
+  for(auto& stripe: m_stripes){
+    std::lock_guard<std::mutex> lock(stripe->mutex);
+    auto& stats = stripe->cache.getStats();
+    ret.hits += stats.hits;
+    ret.misses += stats.misses;
+    ret.evictions += stats.evictions;
+    ret.expirations += stats.expirations;
+  }
+  return ret;
+}
+
+} // namespace lvs
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+#include "ndn-cxx/security/certificate.hpp"
+#include "ndn-cxx/security/transform/public-key.hpp"
+#include "ndn-cxx/security/validation-error.hpp"
+
+namespace lvs {
+
+// CertCache keeps certificates whose chain to a trust anchor has been verified.
+// It holds a bounded number of certificates, evicting the least recently used one,
+// and forgets each certificate when its validity period ends.
+class CertCache {
+public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t expirations = 0;
+  };
+
+  CertCache(size_t capacity, ndn::time::nanoseconds maxLifetime);
+
+  // Cache a verified certificate until min(notAfter, now + maxLifetime).
+  // Certificates outside their validity period are ignored.
+  void
+  insert(const ndn::security::Certificate& cert);
+
+  // Find a cached certificate whose name starts with keyLocator,
+  // which can be either a key name or a certificate name.
+  std::shared_ptr<const ndn::security::Certificate>
+  find(const ndn::Name& keyLocator);
+
+  void
+  erase(const ndn::Name& certName);
+
+  void
+  clear();
+
+  size_t
+  size() const
+  {
+    return m_certs.size();
+  }
+
+  const Stats&
+  getStats() const
+  {
+    return m_stats;
+  }
+
+private:
+  struct Entry {
+    std::shared_ptr<const ndn::security::Certificate> cert;
+    ndn::time::system_clock::time_point expiry;
+    std::list<ndn::Name>::iterator lru;
+  };
+
+  size_t m_capacity;
+  ndn::time::nanoseconds m_maxLifetime;
+  std::map<ndn::Name, Entry> m_certs;
+  std::list<ndn::Name> m_lru;  // Most recently used first
+  Stats m_stats;
+};
+
+// NegativeCertCache remembers key locators whose certificate could not be retrieved or validated,
+// so that Data signed by them fails at once instead of starting another fetch.
+// Each entry expires after the TTL given for its failure; the least recently used is evicted first.
+class NegativeCertCache {
+public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+  };
+
+  explicit NegativeCertCache(size_t capacity);
+
+  // Remember the failure of keyLocator for ttl. A zero ttl is ignored.
+  void
+  insert(const ndn::Name& keyLocator, const ndn::security::ValidationError& error,
+         ndn::time::nanoseconds ttl);
+
+  // The failure recorded for keyLocator, if it has not expired.
+  std::optional<ndn::security::ValidationError>
+  find(const ndn::Name& keyLocator);
+
+  void
+  clear();
+
+  size_t
+  size() const
+  {
+    return m_entries.size();
+  }
+
+  const Stats&
+  getStats() const
+  {
+    return m_stats;
+  }
+
+private:
+  struct Entry {
+    ndn::security::ValidationError error;
+    ndn::time::steady_clock::time_point expiry;
+    std::list<ndn::Name>::iterator lru;
+  };
+
+  size_t m_capacity;
+  std::map<ndn::Name, Entry> m_entries;
+  std::list<ndn::Name> m_lru;  // Most recently used first
+  Stats m_stats;
+};
+
+// PublicKeyCache keeps the decoded public keys of certificates, keyed by certificate name,
+// so that each verification does not decode the key of the certificate again.
+// A key is dropped when its certificate expires; the least recently used is evicted first.
+class PublicKeyCache {
+public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+  };
+
+  explicit PublicKeyCache(size_t capacity);
+
+  // The public key of cert, decoding and caching it on a miss.
+  // Returns nullptr if the key cannot be decoded.
+  std::shared_ptr<const ndn::security::transform::PublicKey>
+  get(const ndn::security::Certificate& cert);
+
+  // Drop the key of certName, e.g. when a certificate of the same name carries another key.
+  void
+  erase(const ndn::Name& certName);
+
+  void
+  clear();
+
+  size_t
+  size() const
+  {
+    return m_entries.size();
+  }
+
+  const Stats&
+  getStats() const
+  {
+    return m_stats;
+  }
+
+private:
+  struct Entry {
+    std::shared_ptr<const ndn::security::transform::PublicKey> key;
+    ndn::time::system_clock::time_point expiry;
+    std::list<ndn::Name>::iterator lru;
+  };
+
+  size_t m_capacity;
+  std::map<ndn::Name, Entry> m_entries;
+  std::list<ndn::Name> m_lru;  // Most recently used first
+  Stats m_stats;
+};
+
+// ValidationResultCache remembers Data packets that passed validation, keyed by full name
+// including the implicit digest, so a duplicate of the same packet is accepted with one lookup.
+// Each entry expires at the time given on insertion; the least recently used is evicted first.
+class ValidationResultCache {
+public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+  };
+
+  explicit ValidationResultCache(size_t capacity);
+
+  void
+  insert(const ndn::Name& fullName, ndn::time::system_clock::time_point expiry);
+
+  // Whether fullName passed validation and the result has not expired.
+  bool
+  contains(const ndn::Name& fullName);
+
+  void
+  clear();
+
+  size_t
+  size() const
+  {
+    return m_entries.size();
+  }
+
+  const Stats&
+  getStats() const
+  {
+    return m_stats;
+  }
+
+private:
+  struct Entry {
+    ndn::time::system_clock::time_point expiry;
+    std::list<ndn::Name>::iterator lru;
+  };
+
+  size_t m_capacity;
+  std::map<ndn::Name, Entry> m_entries;
+  std::list<ndn::Name> m_lru;  // Most recently used first
+  Stats m_stats;
+};
+
+// The key name of a key locator, which is either a key name or a certificate name.
+ndn::Name
+keyNameOf(const ndn::Name& keyLocator);
+
+// ConcurrentCertCache is a CertCache that can be used from several threads.
+// It is split into stripes by key name, each behind its own lock, so threads working on
+// different keys rarely wait on each other, and all certificates of one key share a stripe.
+class ConcurrentCertCache {
+public:
+  // capacity is shared evenly among the stripes.
+  ConcurrentCertCache(size_t capacity, ndn::time::nanoseconds maxLifetime, size_t stripes = 16);
+
+  void
+  insert(const ndn::security::Certificate& cert);
+
+  std::shared_ptr<const ndn::security::Certificate>
+  find(const ndn::Name& keyLocator);
+
+  void
+  erase(const ndn::Name& certName);
+
+  void
+  clear();
+
+  size_t
+  size() const;
+
+  // Statistics summed over the stripes
+  CertCache::Stats
+  getStats() const;
+
+private:
+  struct Stripe {
+    Stripe(size_t capacity, ndn::time::nanoseconds maxLifetime):
+      cache(capacity, maxLifetime)
+    {
+    }
+
+    mutable std::mutex mutex;
+    CertCache cache;
+  };
+
+  Stripe&
+  getStripe(const ndn::Name& keyLocator) const;
+
+  std::vector<std::unique_ptr<Stripe>> m_stripes;
+};
+
+} // namespace lvs
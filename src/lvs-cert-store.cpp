@@ -0,0 +1,158 @@
+#include "lvs-cert-store.hpp"
+#include <sqlite3.h>
+
+namespace lvs {
+
+namespace {
+
+// Finalizes a prepared statement when it goes out of scope
+class Statement {
+public:
+  Statement(sqlite3* db, const char* sql)
+  {
+    if(sqlite3_prepare_v2(db, sql, -1, &m_stmt, nullptr) != SQLITE_OK){
+      throw CertStore::Error(std::string("Cannot prepare statement: ") + sqlite3_errmsg(db));
+    }
+  }
+
+  ~Statement()
+  {
+    sqlite3_finalize(m_stmt);
+  }
+
+  Statement(const Statement&) = delete;
+  Statement& operator=(const Statement&) = delete;
+
+  operator sqlite3_stmt*() const
+  {
+    return m_stmt;
+  }
+
+private:
+  sqlite3_stmt* m_stmt = nullptr;
+};
+
+int64_t
+ToUnixMillis(const ndn::time::system_clock::time_point& t)
+{
+  return ndn::time::duration_cast<ndn::time::milliseconds>(t.time_since_epoch()).count();
+}
+
+ndn::time::system_clock::time_point
+FromUnixMillis(int64_t ms)
+{
+  return ndn::time::system_clock::time_point(ndn::time::milliseconds(ms));
+}
+
+} // namespace
+
+CertStore::CertStore(const std::string& path)
+{
+  if(sqlite3_open_v2(path.c_str(), &m_db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) != SQLITE_OK){
+    std::string msg = m_db != nullptr ? sqlite3_errmsg(m_db) : "out of memory";
+    sqlite3_close(m_db);
+    throw Error("Cannot open certificate store " + path + ": " + msg);
+  }
+  try{
+    exec("CREATE TABLE IF NOT EXISTS certificates ("
+         "  name TEXT PRIMARY KEY,"
+         "  wire BLOB NOT NULL,"
+         "  not_after INTEGER NOT NULL,"
+         "  verified_at INTEGER NOT NULL)");
+  }catch(Error&){
+    sqlite3_close(m_db);
+    throw;
+  }
+}
+
+CertStore::~CertStore()
+{
+  sqlite3_close(m_db);
+}
+
+void
+CertStore::exec(const char* sql)
+{
+  char* errmsg = nullptr;
+  if(sqlite3_exec(m_db, sql, nullptr, nullptr, &errmsg) != SQLITE_OK){
+    std::string msg = errmsg != nullptr ? errmsg : "unknown error";
+    sqlite3_free(errmsg);
+    throw Error("Certificate store error: " + msg);
+  }
+}
+
+void
+CertStore::insert(const ndn::security::Certificate& cert)
+{
+  auto&& wire = cert.wireEncode();
+  auto bytes = std::vector<uint8_t>(wire.begin(), wire.end());
+  auto name = cert.getName().toUri();
+
+  Statement stmt(m_db, "INSERT OR REPLACE INTO certificates (name, wire, not_after, verified_at) "
+                       "VALUES (?, ?, ?, ?)");
+  sqlite3_bind_text(stmt, 1, name.data(), int(name.size()), SQLITE_TRANSIENT);
+  sqlite3_bind_blob(stmt, 2, bytes.data(), int(bytes.size()), SQLITE_TRANSIENT);
+  sqlite3_bind_int64(stmt, 3, ToUnixMillis(cert.getValidityPeriod().getPeriod().second));
+  sqlite3_bind_int64(stmt, 4, ToUnixMillis(ndn::time::system_clock::now()));
+  if(sqlite3_step(stmt) != SQLITE_DONE){
+    throw Error(std::string("Cannot store certificate: ") + sqlite3_errmsg(m_db));
+  }
+}
+
+void
+CertStore::erase(const ndn::Name& certName)
+{
+  auto name = certName.toUri();
+  Statement stmt(m_db, "DELETE FROM certificates WHERE name = ?");
+  sqlite3_bind_text(stmt, 1, name.data(), int(name.size()), SQLITE_TRANSIENT);
+  if(sqlite3_step(stmt) != SQLITE_DONE){
+    throw Error(std::string("Cannot delete certificate: ") + sqlite3_errmsg(m_db));
+  }
+}
+
+std::vector<CertStore::Record>
+CertStore::load()
+{
+  auto now = ToUnixMillis(ndn::time::system_clock::now());
+  {
+    Statement stmt(m_db, "DELETE FROM certificates WHERE not_after <= ?");
+    sqlite3_bind_int64(stmt, 1, now);
+    if(sqlite3_step(stmt) != SQLITE_DONE){
+      throw Error(std::string("Cannot delete expired certificates: ") + sqlite3_errmsg(m_db));
+    }
+  }
+
+  std::vector<Record> ret;
+  std::vector<ndn::Name> malformed;
+  Statement stmt(m_db, "SELECT name, wire, verified_at FROM certificates");
+  int rc;
+  while((rc = sqlite3_step(stmt)) == SQLITE_ROW){
+    auto wire = static_cast<const uint8_t*>(sqlite3_column_blob(stmt, 1));
+    auto size = size_t(sqlite3_column_bytes(stmt, 1));
+    try{
+      ret.push_back(Record{ndn::security::Certificate(ndn::Block(wire, size)),
+                           FromUnixMillis(sqlite3_column_int64(stmt, 2))});
+    }catch(ndn::tlv::Error&){
+      malformed.emplace_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+    }
+  }
+  if(rc != SQLITE_DONE){
+    throw Error(std::string("Cannot load certificates: ") + sqlite3_errmsg(m_db));
+  }
+  for(auto&& name: malformed){
+    erase(name);
+  }
+  return ret;
+}
+
+size_t
+CertStore::size()
+{
+  Statement stmt(m_db, "SELECT COUNT(*) FROM certificates");
+  if(sqlite3_step(stmt) != SQLITE_ROW){
+    throw Error(std::string("Cannot count certificates: ") + sqlite3_errmsg(m_db));
+  }
+  return size_t(sqlite3_column_int64(stmt, 0));
+}
+
+} // namespace lvs
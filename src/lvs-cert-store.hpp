@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "ndn-cxx/security/certificate.hpp"
+
+struct sqlite3;
+
+namespace lvs {
+
+// CertStore keeps verified certificates in an SQLite database, so that a restarted validator
+// can verify their chains again from disk instead of fetching them from the network.
+class CertStore {
+public:
+  class Error: public std::runtime_error {
+  public:
+    using std::runtime_error::runtime_error;
+  };
+
+  struct Record {
+    ndn::security::Certificate cert;
+    // When the chain of the certificate was last verified
+    ndn::time::system_clock::time_point verifiedAt;
+  };
+
+  // Open or create the database at path. Throws Error on failure.
+  explicit CertStore(const std::string& path);
+
+  ~CertStore();
+
+  CertStore(const CertStore&) = delete;
+  CertStore& operator=(const CertStore&) = delete;
+
+  // Store a certificate whose chain has just been verified, replacing any with the same name.
+  void
+  insert(const ndn::security::Certificate& cert);
+
+  void
+  erase(const ndn::Name& certName);
+
+  // All certificates still within their validity period. Expired and undecodable ones are deleted.
+  std::vector<Record>
+  load();
+
+  size_t
+  size();
+
+private:
+  void
+  exec(const char* sql);
+
+private:
+  sqlite3* m_db = nullptr;
+};
+
+} // namespace lvs
@@ -1,9 +1,157 @@
 #include "lvs-checker.hpp"
+#include "lvs-instrumentation.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <set>
+#include <sstream>
 
 namespace lvs {
 
 using ndn::Name;
 
+ndn::Name NameTemplate::prefix() const
+{
+  auto ret = ndn::Name();
+  for(auto&& comp: components) {
+    if(!comp.has_value()) {
+      break;
+    }
+    ret.append(*comp);
+  }
+  return ret;
+}
+
+std::optional<ndn::Name> NameTemplate::name() const
+{
+  auto ret = prefix();
+  if(ret.size() != components.size()) {
+    return std::nullopt;
+  }
+  return ret;
+}
+
+void Checker::VerifyModel()
+{
+  auto node_cnt = model.nodes.size();
+  if(model.start_id >= node_cnt) {
+    throw LvsModelError("Start node does not exist");
+  }
+  for(size_t i = 0; i < node_cnt; i ++) {
+    auto&& node = model.nodes[i];
+    if(node.id != i) {
+      throw LvsModelError("Node IDs must be consecutive and in order");
+    }
+    for(auto&& key_node: node.sign_cons) {
+      if(key_node >= node_cnt) {
+        throw LvsModelError("Signing constraint " + std::to_string(key_node) + " does not exist");
+      }
+    }
+  }
+  for(auto&& sym: model.symbols) {
+    if(sym.tag > model.named_pattern_cnt) {
+      throw LvsModelError("Symbol " + sym.ident + " names unnamed pattern " + std::to_string(sym.tag));
+    }
+  }
+  if(model.nodes[model.start_id].parent.has_value()) {
+    throw LvsModelError("Start node has a parent");
+  }
+
+  // Every other node is reached once, by an edge from its parent, so there is no cycle
+  auto reached = std::vector<bool>(node_cnt, false);
+  auto stack = std::vector<uint64_t>{model.start_id};
+  reached[model.start_id] = true;
+  size_t reached_cnt = 1;
+  while(!stack.empty()) {
+    auto node_id = stack.back();
+    stack.pop_back();
+    auto&& node = model.nodes[node_id];
+    auto reach = [&](uint64_t dest) {
+      if(dest >= node_cnt) {
+        throw LvsModelError("Edge destination " + std::to_string(dest) + " does not exist");
+      }
+      if(reached[dest] || model.nodes[dest].parent != node_id) {
+        throw LvsModelError("Edge from node " + std::to_string(node_id) + " to node " + std::to_string(dest)
+                            + " does not follow the parent links");
+      }
+      reached[dest] = true;
+      reached_cnt ++;
+      stack.push_back(dest);
+    };
+    for(auto&& ve: node.v_edges) {
+      reach(ve.dest);
+    }
+    for(auto&& pe: node.p_edges) {
+      reach(pe.dest);
+    }
+  }
+  if(reached_cnt != node_cnt) {
+    throw LvsModelError("Nodes not reachable from the start node");
+  }
+}
+
+void Checker::BuildLiteralTables()
+{
+  literals.resize(model.nodes.size());
+  for(size_t i = 0; i < model.nodes.size(); i ++) {
+    auto&& node = model.nodes[i];
+    auto&& tables = literals[i];
+    for(size_t j = 0; j < node.v_edges.size(); j ++) {
+      if(!tables.v_edges.insert(node.v_edges[j].value, j)) {
+        throw LvsModelError("Malformed name component in value edge of node " + std::to_string(i));
+      }
+    }
+    tables.cons.resize(node.p_edges.size());
+    for(size_t j = 0; j < node.p_edges.size(); j ++) {
+      auto&& cons_sets = node.p_edges[j].cons_sets;
+      tables.cons[j].resize(cons_sets.size());
+      for(size_t k = 0; k < cons_sets.size(); k ++) {
+        auto&& options = cons_sets[k].options;
+        for(size_t l = 0; l < options.size(); l ++) {
+          if(options[l].value.has_value() && !tables.cons[j][k].insert(*options[l].value, l)) {
+            throw LvsModelError("Malformed name component in constraint of node " + std::to_string(i));
+          }
+        }
+      }
+    }
+  }
+}
+
+void Checker::BuildRuleIndex()
+{
+  in_edges.resize(model.nodes.size(), InEdge{false, 0});
+  for(auto&& node: model.nodes) {
+    for(size_t j = 0; j < node.v_edges.size(); j ++) {
+      in_edges[node.v_edges[j].dest] = InEdge{true, j};
+    }
+    for(size_t j = 0; j < node.p_edges.size(); j ++) {
+      in_edges[node.p_edges[j].dest] = InEdge{false, j};
+    }
+    for(auto&& rule: node.rule_name) {
+      rule_nodes[rule].push_back(node.id);
+    }
+  }
+#ifdef LVS_CXX_HAVE_INSTRUMENTATION
+  rule_ids.resize(model.nodes.size());
+  for(auto&& node: model.nodes) {
+    for(auto&& rule: node.rule_name) {
+      rule_ids[node.id].push_back(instrumentation::internRule(rule));
+    }
+  }
+#endif
+}
+
+std::vector<uint64_t> Checker::PathTo(uint64_t node_id)
+{
+  auto ret = std::vector<uint64_t>();
+  for(std::optional<uint64_t> cur = node_id; cur.has_value(); cur = model.nodes[*cur].parent) {
+    ret.push_back(*cur);
+  }
+  ret.pop_back();  // The root has no incoming edge
+  std::reverse(ret.begin(), ret.end());
+  return ret;
+}
+
 std::map<std::string, Name::Component> Checker::ContextToName(const Checker::Context& context)
 {
   auto ret = std::map<std::string, Name::Component>();
@@ -15,18 +163,24 @@ std::map<std::string, Name::Component> Checker::ContextToName(const Checker::Con
   return ret;
 }
 
-bool Checker::CheckConstraints(Name::Component value,
+bool Checker::CheckConstraints(const Name::Component& value,
                                const Checker::Context& context,
-                               const std::vector<PatternConstraint>& cons_sets)
+                               const std::vector<PatternConstraint>& cons_sets,
+                               const std::vector<LiteralTable>& cons_literals,
+                               size_t* failed)
 {
-  for(auto&& cons: cons_sets) {
-    bool satisfied = false;
-    for(auto&& option: cons.options) {
+  for(size_t i = 0; i < cons_sets.size(); i ++) {
+    LVS_COUNT(CONSTRAINT_EVALS, 1);
+    // Options are tried in schema order, as user functions may have side effects.
+    // The table finds the first literal option matching, so no literal is compared one by one.
+    auto&& options = cons_sets[i].options;
+    auto literal = cons_literals[i].find(value);
+    auto end = literal.has_value() ? *literal : options.size();
+    bool satisfied = literal.has_value();
+    for(size_t j = 0; j < end; j ++) {
+      auto&& option = options[j];
       if(option.value.has_value()) {
-        if(value == Name::Component(ndn::Block(option.value->data(), option.value->size()))) {
-          satisfied = true;
-          break;
-        }
+        continue;
       } else if(option.tag.has_value()) {
         if(value == context[*option.tag]) {
           satisfied = true;
@@ -54,6 +208,7 @@ bool Checker::CheckConstraints(Name::Component value,
             }
           }
         }
+        LVS_COUNT(USER_FN_CALLS, 1);
         if(fn->second(value, arg_list)) {
           satisfied = true;
           break;
@@ -61,6 +216,9 @@ bool Checker::CheckConstraints(Name::Component value,
       }
     }
     if(!satisfied){
+      if(failed != nullptr) {
+        *failed = i;
+      }
       return false;
     }
   }
@@ -68,7 +226,7 @@ bool Checker::CheckConstraints(Name::Component value,
 }
 
 Generator<std::tuple<uint64_t, const Checker::Context*>>
-Checker::match(const ndn::Name& name, const Checker::Context& context) {
+Checker::match(const ndn::Name& name, const Checker::Context& context, Checker::Budget* budget) {
   std::optional<uint64_t> cur = model.start_id;
   int edge_index = -1;
   auto edge_indices = std::vector<int>();
@@ -81,7 +239,14 @@ Checker::match(const ndn::Name& name, const Checker::Context& context) {
   auto&& node = model.nodes[*cur];
   return [=]() mutable -> std::tuple<uint64_t, const Checker::Context*> {
     while(true){
+      if(budget != nullptr){
+        budget->step();
+      }
       if(backtrack){
+        LVS_COUNT(BACKTRACKS, 1);
+        if(budget != nullptr) {
+          budget->note({ExplainEvent::BACKTRACK, false, false, uint32_t(edge_indices.size()), 0, 0, node.id, 0});
+        }
         if(!edge_indices.empty()) {
           edge_index = edge_indices.back();
           edge_indices.pop_back();
@@ -103,6 +268,9 @@ Checker::match(const ndn::Name& name, const Checker::Context& context) {
       auto depth = edge_indices.size();
       node = model.nodes[*cur];
       if(depth == name.size()) {
+        if(budget != nullptr) {
+          budget->note({ExplainEvent::MATCH, false, false, uint32_t(depth), 0, 0, *cur, 0});
+        }
         backtrack = true;
         return {*cur, &con};
       }
@@ -110,27 +278,42 @@ Checker::match(const ndn::Name& name, const Checker::Context& context) {
       if(edge_index < 0){
         // Value edge: since it matches at most once, ignore edge_index
         edge_index = 0;
-        for(auto&& ve: node.v_edges) {
-          if(name[depth] == Name::Component(ndn::Block(ve.value.data(), ve.value.size()))) {
-            edge_indices.push_back(0);
-            matches.push_back(0);
-            cur = ve.dest;
-            edge_index = -1;
-            break;
+        LVS_COUNT(EDGES_TRIED, 1);
+        auto ve_index = literals[*cur].v_edges.find(name[depth]);
+        if(ve_index.has_value()) {
+          if(budget != nullptr) {
+            budget->note({ExplainEvent::VALUE_EDGE, false, false, uint32_t(depth), uint32_t(*ve_index), 0,
+                          *cur, node.v_edges[*ve_index].dest});
           }
+          edge_indices.push_back(0);
+          matches.push_back(0);
+          cur = node.v_edges[*ve_index].dest;
+          edge_index = -1;
+        } else if(budget != nullptr && !node.v_edges.empty()) {
+          budget->note({ExplainEvent::VALUE_MISS, false, false, uint32_t(depth), 0, 0, *cur, 0});
         }
       } else if(size_t(edge_index) < node.p_edges.size()) {
         // Pattern edge: check condition and make a move
         auto& pe = node.p_edges[edge_index];
         edge_index ++;
+        LVS_COUNT(EDGES_TRIED, 1);
         auto& value = name[depth];
         if(pe.tag <= model.named_pattern_cnt && con[pe.tag]){
           if(value != *con[pe.tag]){
+            if(budget != nullptr) {
+              budget->note({ExplainEvent::TAG_MISMATCH, false, false, uint32_t(depth), uint32_t(edge_index - 1), 0,
+                            *cur, pe.dest});
+            }
             continue;
           }
           matches.push_back(-1);
         } else {
-          if(!CheckConstraints(value, con, pe.cons_sets)){
+          size_t failed = 0;
+          if(!CheckConstraints(value, con, pe.cons_sets, literals[*cur].cons[edge_index - 1], &failed)){
+            if(budget != nullptr) {
+              budget->note({ExplainEvent::CONSTRAINT_FAILED, false, false, uint32_t(depth), uint32_t(edge_index - 1),
+                            uint32_t(failed), *cur, pe.dest});
+            }
             continue;
           }
           if(pe.tag <= model.named_pattern_cnt) {
@@ -140,6 +323,10 @@ Checker::match(const ndn::Name& name, const Checker::Context& context) {
             matches.push_back(-1);
           }
         }
+        if(budget != nullptr) {
+          budget->note({ExplainEvent::PATTERN_EDGE, false, false, uint32_t(depth), uint32_t(edge_index - 1), 0,
+                        *cur, pe.dest});
+        }
         edge_indices.push_back(edge_index);
         cur = pe.dest;
         edge_index = -1;
@@ -162,20 +349,339 @@ Checker::match(const ndn::Name& name)
   };
 }
 
-bool Checker::check(const ndn::Name& pkt_name, const ndn::Name& key_name)
+void Checker::MatchAll(const std::vector<ndn::Name>& names, const std::vector<size_t>& order,
+                       size_t begin, size_t end, size_t depth, uint64_t node_id, Checker::Context& context,
+                       const Checker::MatchAllCallback& callback)
+{
+  auto&& node = model.nodes[node_id];
+  // Names in [begin, end) share the first depth components, and shorter names come first
+  if(begin < end && names[order[begin]].size() == depth) {
+    auto captures = ContextToName(context);
+    for(; begin < end && names[order[begin]].size() == depth; begin ++) {
+      callback(order[begin], node.rule_name, captures);
+    }
+  }
+  while(begin < end) {
+    // Names with the same component at depth are adjacent
+    auto& value = names[order[begin]][depth];
+    auto group_end = begin + 1;
+    while(group_end < end && names[order[group_end]][depth] == value) {
+      group_end ++;
+    }
+
+    auto ve_index = literals[node_id].v_edges.find(value);
+    if(ve_index.has_value()) {
+      MatchAll(names, order, begin, group_end, depth + 1, node.v_edges[*ve_index].dest, context, callback);
+    }
+    for(size_t i = 0; i < node.p_edges.size(); i ++) {
+      auto&& pe = node.p_edges[i];
+      if(pe.tag <= model.named_pattern_cnt && context[pe.tag]) {
+        if(value == *context[pe.tag]) {
+          MatchAll(names, order, begin, group_end, depth + 1, pe.dest, context, callback);
+        }
+      } else if(CheckConstraints(value, context, pe.cons_sets, literals[node_id].cons[i])) {
+        if(pe.tag <= model.named_pattern_cnt) {
+          context[pe.tag] = value;
+          MatchAll(names, order, begin, group_end, depth + 1, pe.dest, context, callback);
+          context[pe.tag] = std::nullopt;
+        } else {
+          MatchAll(names, order, begin, group_end, depth + 1, pe.dest, context, callback);
+        }
+      }
+    }
+    begin = group_end;
+  }
+}
+
+void Checker::match_all(const std::vector<ndn::Name>& names, const Checker::MatchAllCallback& callback)
+{
+  auto order = std::vector<size_t>(names.size());
+  for(size_t i = 0; i < order.size(); i ++) {
+    order[i] = i;
+  }
+  if(!std::is_sorted(names.begin(), names.end())) {
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return names[a] < names[b];
+    });
+  }
+  auto context = Context(model.named_pattern_cnt + 1);
+  MatchAll(names, order, 0, names.size(), 0, model.start_id, context, callback);
+}
+
+NameTemplate Checker::MakeTemplate(uint64_t node_id, const Checker::Context& context)
+{
+  auto ret = NameTemplate{&model.nodes[node_id].rule_name, {}, {}};
+  for(auto id: PathTo(node_id)) {
+    auto&& parent = model.nodes[*model.nodes[id].parent];
+    auto edge = in_edges[id];
+    if(edge.value_edge) {
+      auto&& value = parent.v_edges[edge.index].value;
+      ret.components.emplace_back(Name::Component(ndn::Block(value.data(), value.size())));
+      ret.tags.push_back(0);
+    } else {
+      auto tag = parent.p_edges[edge.index].tag;
+      if(tag < context.size() && context[tag].has_value()) {
+        ret.components.push_back(context[tag]);
+      } else {
+        ret.components.push_back(std::nullopt);
+      }
+      ret.tags.push_back(tag);
+    }
+  }
+  return ret;
+}
+
+std::vector<NameTemplate> Checker::suggest_keys(const ndn::Name& pkt_name, bool pkt_prefix)
 {
+  auto ret = std::vector<NameTemplate>();
   auto pkt_matcher = match(pkt_name, {});
   try{
     while(true){
+      auto [node_id, contest_ptr] = pkt_matcher();
+      if(!pkt_prefix) {
+        for(auto key_node: model.nodes[node_id].sign_cons) {
+          ret.push_back(MakeTemplate(key_node, *contest_ptr));
+        }
+        continue;
+      }
+      // Walk the subtree under the prefix
+      auto stack = std::vector<uint64_t>{node_id};
+      while(!stack.empty()) {
+        auto&& node = model.nodes[stack.back()];
+        stack.pop_back();
+        for(auto key_node: node.sign_cons) {
+          auto tmpl = MakeTemplate(key_node, *contest_ptr);
+          auto same = [&](const NameTemplate& other) {
+            return other.rule_name == tmpl.rule_name && other.components == tmpl.components;
+          };
+          if(std::none_of(ret.begin(), ret.end(), same)) {
+            ret.push_back(std::move(tmpl));
+          }
+        }
+        for(auto&& ve: node.v_edges) {
+          stack.push_back(ve.dest);
+        }
+        for(auto&& pe: node.p_edges) {
+          stack.push_back(pe.dest);
+        }
+      }
+    }
+  }catch(StopIteration&){
+    return ret;
+  }
+}
+
+std::optional<ndn::Name> Checker::make_name(const std::string& rule_name,
+                                            const std::map<std::string, Name::Component>& bindings)
+{
+  auto nodes = rule_nodes.find(rule_name);
+  if(nodes == rule_nodes.end()) {
+    return std::nullopt;
+  }
+  for(auto node_id: nodes->second) {
+    // Tags are bound in path order, so constraints see the same context as in match()
+    auto context = Context(model.named_pattern_cnt + 1);
+    auto name = ndn::Name();
+    bool ok = true;
+    for(auto id: PathTo(node_id)) {
+      auto parent_id = *model.nodes[id].parent;
+      auto&& parent = model.nodes[parent_id];
+      auto edge = in_edges[id];
+      if(edge.value_edge) {
+        auto&& value = parent.v_edges[edge.index].value;
+        name.append(Name::Component(ndn::Block(value.data(), value.size())));
+        continue;
+      }
+      auto&& pe = parent.p_edges[edge.index];
+      if(pe.tag > model.named_pattern_cnt || pe.tag >= symbols.size()) {
+        ok = false;
+        break;
+      }
+      auto binding = bindings.find(symbols[pe.tag]);
+      if(binding == bindings.end()) {
+        ok = false;
+        break;
+      }
+      if(!context[pe.tag].has_value()) {
+        if(!CheckConstraints(binding->second, context, pe.cons_sets, literals[parent_id].cons[edge.index])) {
+          ok = false;
+          break;
+        }
+        context[pe.tag] = binding->second;
+      }
+      name.append(binding->second);
+    }
+    if(ok) {
+      return name;
+    }
+  }
+  return std::nullopt;
+}
+
+bool Checker::check(const ndn::Name& pkt_name, const ndn::Name& key_name)
+{
+  return CheckWithBudget(pkt_name, key_name, false);
+}
+
+bool Checker::check_key_prefix(const ndn::Name& pkt_name, const ndn::Name& key_prefix)
+{
+  return CheckWithBudget(pkt_name, key_prefix, true);
+}
+
+bool Checker::CheckWithBudget(const ndn::Name& pkt_name, const ndn::Name& key_name, bool key_prefix)
+{
+  auto budget = Budget();
+  budget.max_steps = limits.max_steps;
+  if(limits.max_duration.count() > 0) {
+    budget.deadline = std::chrono::steady_clock::now() + limits.max_duration;
+  }
+  auto update_peak = [&] {
+    auto peak = peak_steps.value.load(std::memory_order_relaxed);
+    while(budget.steps > peak && !peak_steps.value.compare_exchange_weak(peak, budget.steps)) {
+    }
+  };
+  LVS_COUNT(CHECKS, 1);
+  LVS_CHECK_BEGIN();
+  LVS_PROBE2(match_start, pkt_name.wireEncode().data(), pkt_name.wireEncode().size());
+  try{
+    auto ret = check(pkt_name, key_name, key_prefix, budget);
+    update_peak();
+    LVS_COUNT(CHECKS_ACCEPTED, ret ? 1 : 0);
+    LVS_CHECK_END(ret);
+    LVS_PROBE3(match_end, pkt_name.wireEncode().data(), int(ret), budget.steps);
+    return ret;
+  }catch(BudgetExceeded&){
+    update_peak();
+    LVS_PROBE3(match_end, pkt_name.wireEncode().data(), -1, budget.steps);
+    throw;
+  }
+}
+
+Explanation Checker::explain(const ndn::Name& pkt_name, const ndn::Name& key_name,
+                             size_t max_events, bool key_prefix)
+{
+  auto ret = Explanation();
+  ret.pkt_name = pkt_name;
+  ret.key_name = key_name;
+  ret.max_events = max_events;
+  ret.events.reserve(std::min<size_t>(max_events, 1024));
+
+  auto budget = Budget();
+  budget.max_steps = limits.max_steps;
+  if(limits.max_duration.count() > 0) {
+    budget.deadline = std::chrono::steady_clock::now() + limits.max_duration;
+  }
+  budget.explain = &ret;
+  // Not counted as a check, but the search still records the rules it tries
+  LVS_CHECK_BEGIN();
+  try{
+    ret.result = check(pkt_name, key_name, key_prefix, budget);
+  }catch(BudgetExceeded&){
+    ret.budget_exceeded = true;
+  }
+
+  for(auto&& event: ret.events) {
+    if(event.kind == ExplainEvent::MATCH || event.kind == ExplainEvent::SIGN_CONS) {
+      ret.rule_names[event.node] = model.nodes[event.node].rule_name;
+    }
+    if(event.kind == ExplainEvent::SIGN_CONS) {
+      ret.rule_names[event.target] = model.nodes[event.target].rule_name;
+    }
+  }
+  return ret;
+}
+
+void Explanation::print(std::ostream& os) const
+{
+  auto rules_of = [this](uint64_t node_id) {
+    auto ret = std::string();
+    auto it = rule_names.find(node_id);
+    if(it != rule_names.end()) {
+      for(auto&& rule: it->second) {
+        ret += " " + rule;
+      }
+    }
+    return ret;
+  };
+
+  os << "check " << pkt_name << " signed by " << key_name << ": "
+     << (budget_exceeded ? "budget exceeded" : result ? "accepted" : "rejected") << "\n";
+  for(auto&& e: events) {
+    os << (e.key ? "  key " : "  pkt ") << "[" << e.depth << "] ";
+    switch(e.kind) {
+    case ExplainEvent::VALUE_EDGE:
+      os << "node " << e.node << " value edge " << e.edge << " -> " << e.target;
+      break;
+    case ExplainEvent::PATTERN_EDGE:
+      os << "node " << e.node << " pattern edge " << e.edge << " -> " << e.target;
+      break;
+    case ExplainEvent::VALUE_MISS:
+      os << "node " << e.node << " no value edge takes the component";
+      break;
+    case ExplainEvent::TAG_MISMATCH:
+      os << "node " << e.node << " pattern edge " << e.edge << " bound to another value";
+      break;
+    case ExplainEvent::CONSTRAINT_FAILED:
+      os << "node " << e.node << " pattern edge " << e.edge << " failed constraint " << e.constraint;
+      break;
+    case ExplainEvent::BACKTRACK:
+      os << "node " << e.node << " backtrack";
+      break;
+    case ExplainEvent::MATCH:
+      os << "matched node " << e.node << rules_of(e.node);
+      break;
+    case ExplainEvent::SIGN_CONS:
+      os << "node " << e.node << rules_of(e.node) << " sign_cons " << e.edge
+         << (e.ok ? " allows " : " does not allow ") << "key node " << e.target << rules_of(e.target);
+      break;
+    }
+    os << "\n";
+  }
+  if(dropped > 0) {
+    os << "  ... " << dropped << " more events\n";
+  }
+}
+
+std::string Explanation::to_string() const
+{
+  std::ostringstream os;
+  print(os);
+  return os.str();
+}
+
+bool Checker::IsAncestor(uint64_t ancestor, uint64_t node_id) const
+{
+  for(std::optional<uint64_t> cur = node_id; cur.has_value(); cur = model.nodes[*cur].parent) {
+    if(*cur == ancestor) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Checker::check(const ndn::Name& pkt_name, const ndn::Name& key_name, bool key_prefix,
+                    Checker::Budget& budget)
+{
+  auto pkt_matcher = match(pkt_name, {}, &budget);
+  try{
+    while(true){
+      budget.matching_key = false;
       auto [node_id, contest_ptr] = pkt_matcher();
       auto&& pkt_node = model.nodes[node_id];
+      LVS_CHECK_RULES(rule_ids[node_id]);
       const Context& context = *contest_ptr;
-      auto key_matcher = match(key_name, context);
+      auto key_matcher = match(key_name, context, &budget);
       try{
         while(true){
-          auto [node_id, contest_ptr] = key_matcher();
-          for(auto sig_node: pkt_node.sign_cons) {
-            if(sig_node == node_id) {
+          budget.matching_key = true;
+          auto [key_node, contest_ptr] = key_matcher();
+          for(size_t i = 0; i < pkt_node.sign_cons.size(); i ++) {
+            auto sig_node = pkt_node.sign_cons[i];
+            // match() also yields inner nodes, which are prefixes of the rules below them
+            bool ok = sig_node == key_node || (key_prefix && IsAncestor(key_node, sig_node));
+            budget.note({ExplainEvent::SIGN_CONS, false, ok, uint32_t(key_name.size()), uint32_t(i), 0,
+                         node_id, key_node});
+            if(ok) {
               return true;
             }
           }
@@ -189,4 +695,160 @@ bool Checker::check(const ndn::Name& pkt_name, const ndn::Name& key_name)
   }
 }
 
+namespace {
+
+size_t SaturatingAdd(size_t a, size_t b)
+{
+  return a > SIZE_MAX - b ? SIZE_MAX : a + b;
+}
+
+size_t SaturatingMul(size_t a, size_t b)
+{
+  return (a != 0 && b > SIZE_MAX / a) ? SIZE_MAX : a * b;
+}
+
+// Worst-case cost of the subtree of one node
+struct NodeCost {
+  size_t visits;
+  size_t matches;
+  size_t depth;
+  size_t nested_ambiguity;  // Largest number of ambiguous nodes on one downward path
+};
+
+class Analyzer {
+public:
+  Analyzer(const LvsModel& model, SchemaReport& report):
+    model(model), report(report), costs(model.nodes.size()), entered(model.nodes.size(), false)
+  {}
+
+  // Each node is analyzed once; reaching one twice means the edges do not form a tree
+  NodeCost analyze(uint64_t node_id) {
+    if(node_id >= model.nodes.size()) {
+      throw LvsModelError("Edge destination " + std::to_string(node_id) + " does not exist");
+    }
+    if(entered[node_id]) {
+      throw LvsModelError(std::string(costs[node_id].has_value() ? "More than one edge" : "A cycle")
+                          + " leads to node " + std::to_string(node_id));
+    }
+    entered[node_id] = true;
+    auto&& node = model.nodes[node_id];
+
+    // Edges that take any component, and edges that only take some literals
+    auto unrestricted = std::vector<uint64_t>();
+    auto by_literal = std::map<tlv::NameComponent, std::vector<uint64_t>>();
+    for(auto&& ve: node.v_edges) {
+      by_literal[ve.value].push_back(ve.dest);
+    }
+    for(auto&& pe: node.p_edges) {
+      auto domain = LiteralDomain(pe);
+      if(!domain.has_value()) {
+        unrestricted.push_back(pe.dest);
+      } else {
+        for(auto&& lit: *domain) {
+          by_literal[lit].push_back(pe.dest);
+        }
+      }
+    }
+
+    auto ret = NodeCost{1, 1, 0, 0};
+    for(auto&& edge: node.v_edges) {
+      costs[edge.dest] = analyze(edge.dest);
+    }
+    for(auto&& edge: node.p_edges) {
+      costs[edge.dest] = analyze(edge.dest);
+    }
+    auto cost = [&](uint64_t dest) -> const NodeCost& {
+      return *costs[dest];
+    };
+
+    size_t visits = 0, matches = 0, branching = unrestricted.size();
+    for(auto dest: unrestricted) {
+      visits = SaturatingAdd(visits, cost(dest).visits);
+      matches = SaturatingAdd(matches, cost(dest).matches);
+    }
+    size_t lit_visits = 0, lit_matches = 0, lit_branching = 0;
+    for(auto&& [lit, dests]: by_literal) {
+      size_t v = 0, m = 0;
+      for(auto dest: dests) {
+        v = SaturatingAdd(v, cost(dest).visits);
+        m = SaturatingAdd(m, cost(dest).matches);
+      }
+      lit_visits = std::max(lit_visits, v);
+      lit_matches = std::max(lit_matches, m);
+      lit_branching = std::max(lit_branching, dests.size());
+    }
+    branching += lit_branching;
+    ret.visits = SaturatingAdd(1, SaturatingAdd(visits, lit_visits));
+    ret.matches = std::max<size_t>(1, SaturatingAdd(matches, lit_matches));
+
+    auto add_child = [&](uint64_t dest) {
+      ret.depth = std::max(ret.depth, cost(dest).depth + 1);
+      ret.nested_ambiguity = std::max(ret.nested_ambiguity, cost(dest).nested_ambiguity);
+    };
+    for(auto&& edge: node.v_edges) {
+      add_child(edge.dest);
+    }
+    for(auto&& edge: node.p_edges) {
+      add_child(edge.dest);
+    }
+    if(branching >= 2) {
+      report.ambiguous_nodes.push_back(node_id);
+      ret.nested_ambiguity ++;
+    }
+    return ret;
+  }
+
+private:
+  // Literals a pattern edge can take, or nullopt if it is not limited to literals
+  static std::optional<std::set<tlv::NameComponent>>
+  LiteralDomain(const PatternEdge& pe) {
+    std::optional<std::set<tlv::NameComponent>> ret;
+    for(auto&& cons: pe.cons_sets) {
+      auto lits = std::set<tlv::NameComponent>();
+      bool literal_only = true;
+      for(auto&& option: cons.options) {
+        if(!option.value.has_value()) {
+          literal_only = false;
+          break;
+        }
+        lits.insert(*option.value);
+      }
+      if(!literal_only) {
+        continue;
+      }
+      if(!ret.has_value()) {
+        ret = std::move(lits);
+      } else {
+        auto both = std::set<tlv::NameComponent>();
+        std::set_intersection(ret->begin(), ret->end(), lits.begin(), lits.end(),
+                              std::inserter(both, both.begin()));
+        ret = std::move(both);
+      }
+    }
+    return ret;
+  }
+
+private:
+  const LvsModel& model;
+  SchemaReport& report;
+  std::vector<std::optional<NodeCost>> costs;  // Of the nodes analyzed, by ID
+  std::vector<bool> entered;
+};
+
+} // namespace
+
+SchemaReport Checker::analyze() const
+{
+  auto report = SchemaReport();
+  auto root = Analyzer(model, report).analyze(model.start_id);
+  std::sort(report.ambiguous_nodes.begin(), report.ambiguous_nodes.end());
+  report.max_depth = root.depth;
+  report.worst_visits = root.visits;
+  report.worst_matches = root.matches;
+  // Every match of the packet name starts a new search for the key name
+  report.worst_check_steps = SaturatingAdd(root.visits, SaturatingMul(root.matches, root.visits));
+  report.super_linear = root.nested_ambiguity >= 2;
+  return report;
+}
+
 } // namespace lvs
\ No newline at end of file
@@ -1,13 +1,17 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <vector>
 #include <map>
 #include <string>
 #include <exception>
+#include <ostream>
 #include <ndn-cxx/name.hpp>
 #include "tlv-encoder.hpp"
 #include "lvs-binary.hpp"
+#include "lvs-literal-table.hpp"
 
 namespace lvs {
 
@@ -29,39 +33,279 @@ struct LvsModelError: std::exception {
   }
 };
 
+// BudgetExceeded is thrown by check() when it takes more work than CheckLimits allow.
+struct BudgetExceeded: std::exception {
+  size_t steps;
+  BudgetExceeded(size_t steps): steps(steps) {}
+  const char* what() const noexcept override {
+    return "LVS check exceeded its work budget";
+  }
+};
+
+// CheckLimits bounds the work of one check(). A step is one edge tried by the matcher.
+struct CheckLimits {
+  size_t max_steps = 0;                    // 0 for no limit
+  std::chrono::nanoseconds max_duration{}; // 0 for no limit
+};
+
+// SchemaReport is the worst-case search cost of a schema, found by Checker::analyze().
+// The bounds are conservative: tag and user function constraints are assumed to always pass.
+struct SchemaReport {
+  size_t max_depth = 0;          // Length of the longest rule
+  size_t worst_visits = 0;       // Nodes visited by match() for one name
+  size_t worst_matches = 0;      // Matches of one name
+  size_t worst_check_steps = 0;  // Nodes visited by one check()
+  // Nodes where several edges can take the same component, so the matcher backtracks
+  std::vector<uint64_t> ambiguous_nodes;
+  // Whether a path has more than one ambiguous node, so the search grows with the product
+  // of their branching factors instead of linearly with the name length
+  bool super_linear = false;
+};
+
+// NameTemplate is a name pattern of the schema with the known components filled in.
+struct NameTemplate {
+  const std::vector<std::string>* rule_name;
+  // Each component is either fixed, or a pattern whose tag is in tags and still unbound
+  std::vector<std::optional<ndn::Name::Component>> components;
+  std::vector<uint64_t> tags;
+
+  // The longest prefix made of fixed components
+  ndn::Name prefix() const;
+
+  // The whole name, if every component is fixed
+  std::optional<ndn::Name> name() const;
+};
+
+// One step of the search of Checker::explain().
+struct ExplainEvent {
+  enum Kind: uint8_t {
+    VALUE_EDGE,         // Took value edge `edge` from node to target
+    PATTERN_EDGE,       // Took pattern edge `edge` from node to target
+    VALUE_MISS,         // No value edge of node takes the component at depth
+    TAG_MISMATCH,       // Pattern edge `edge` of node has a tag bound to another value
+    CONSTRAINT_FAILED,  // Constraint `constraint` of pattern edge `edge` of node rejected the component
+    BACKTRACK,          // Left node back to its parent
+    MATCH,              // The whole name matched node
+    SIGN_CONS,          // Checked whether the key matching target is sign_cons `edge` of packet node `node`
+  };
+
+  Kind kind;
+  bool key;        // Whether the key name was being matched, rather than the packet name
+  bool ok;         // SIGN_CONS: whether the key node is allowed
+  uint32_t depth;  // Index of the name component
+  uint32_t edge;
+  uint32_t constraint;
+  uint64_t node;
+  uint64_t target;
+};
+
+// A bounded trace of the search done by one check, from Checker::explain().
+struct Explanation {
+  ndn::Name pkt_name;
+  ndn::Name key_name;
+  bool result = false;
+  bool budget_exceeded = false;
+  size_t max_events = 0;
+  size_t dropped = 0;  // Events after the first max_events
+  std::vector<ExplainEvent> events;
+  std::map<uint64_t, std::vector<std::string>> rule_names;  // Of the nodes that matched
+
+  void add(const ExplainEvent& event) {
+    if(events.size() < max_events) {
+      events.push_back(event);
+    } else {
+      dropped ++;
+    }
+  }
+
+  void print(std::ostream& os) const;
+
+  std::string to_string() const;
+};
+
 class Checker {
 private:
+  // Literal lookup tables of a node, built once from the model
+  struct NodeLiterals {
+    LiteralTable v_edges;                        // Value edge index by component
+    std::vector<std::vector<LiteralTable>> cons; // Literal options of each [p_edge][constraint]
+  };
+
+  // The edge from the parent of a node to the node
+  struct InEdge {
+    bool value_edge;
+    size_t index;
+  };
+
   LvsModel model;
   std::map<std::string, UserFn> user_fns;
   std::vector<std::string> symbols;
+  std::vector<NodeLiterals> literals;
+  std::vector<InEdge> in_edges;
+  std::map<std::string, std::vector<uint64_t>> rule_nodes;
+  // Instrumentation index of the rule names of each node, when built with instrumentation
+  std::vector<std::vector<uint32_t>> rule_ids;
+  CheckLimits limits;
+
+  // The peak step count, which may be updated by concurrent checks.
+  // It copies by value, so that Checker stays copyable and movable.
+  struct PeakSteps {
+    std::atomic<size_t> value{0};
+
+    PeakSteps() = default;
+
+    PeakSteps(const PeakSteps& other):
+      value(other.value.load(std::memory_order_relaxed))
+    {
+    }
+
+    PeakSteps& operator=(const PeakSteps& other) {
+      value.store(other.value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      return *this;
+    }
+  };
+
+  PeakSteps peak_steps;
+
+  // Work done by one check()
+  struct Budget {
+    size_t steps = 0;
+    size_t max_steps = 0;
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    // Only set by explain(); other checks pay one predictable branch per event in note()
+    Explanation* explain = nullptr;
+    bool matching_key = false;
+
+    inline void note(ExplainEvent event) {
+      if(explain != nullptr) {
+        event.key = matching_key;
+        explain->add(event);
+      }
+    }
+
+    inline void step() {
+      steps ++;
+      if(max_steps > 0 && steps > max_steps) {
+        throw BudgetExceeded(steps);
+      }
+      // Reading the clock is costly, so only do it once in a while
+      if(deadline.has_value() && steps % 64 == 0 && std::chrono::steady_clock::now() > *deadline) {
+        throw BudgetExceeded(steps);
+      }
+    }
+  };
 
 public:
   using Context = std::vector<std::optional<ndn::Name::Component>>;
 
+  // Called by match_all() once per match: index of the name, rule name and captures.
+  using MatchAllCallback = std::function<void(size_t,
+                                              const std::vector<std::string>&,
+                                              const std::map<std::string, ndn::Name::Component>&)>;
+
   Checker(LvsModel model, std::map<std::string, UserFn> user_fns):
     model(model), user_fns(user_fns)
   {
+    VerifyModel();
     symbols.resize(model.named_pattern_cnt + 1);
     for(auto&& sym: model.symbols){
       symbols[sym.tag] = sym.ident;
     }
+    BuildLiteralTables();
+    BuildRuleIndex();
   }
 
 private:
+  // Throws LvsModelError unless the nodes form a tree under the start node, with edges, parents,
+  // signing constraints and tags in range, so that walks of the model always end.
+  void VerifyModel();
+
+  void BuildLiteralTables();
+
+  void BuildRuleIndex();
+
+  // Node IDs from the child of the root down to node_id
+  std::vector<uint64_t> PathTo(uint64_t node_id);
+
+  NameTemplate MakeTemplate(uint64_t node_id, const Context& context);
+
   std::map<std::string, ndn::Name::Component> ContextToName(const Context& context);
 
-  bool CheckConstraints(ndn::Name::Component value,
+  // Sets failed to the index of the first constraint that rejects value, if any.
+  bool CheckConstraints(const ndn::Name::Component& value,
                         const Context& context,
-                        const std::vector<PatternConstraint>& cons_sets);
+                        const std::vector<PatternConstraint>& cons_sets,
+                        const std::vector<LiteralTable>& cons_literals,
+                        size_t* failed = nullptr);
 
   Generator<std::tuple<uint64_t, const Context*>>
-  match(const ndn::Name& name, const Context& context);
+  match(const ndn::Name& name, const Context& context, Budget* budget = nullptr);
+
+  void MatchAll(const std::vector<ndn::Name>& names, const std::vector<size_t>& order,
+                size_t begin, size_t end, size_t depth, uint64_t node_id, Context& context,
+                const MatchAllCallback& callback);
 
 public:
   Generator<std::tuple<const std::vector<std::string>*, std::map<std::string, ndn::Name::Component>>>
   match(const ndn::Name& name);
 
+  // Match a whole set of names in one walk of the schema.
+  // Names sharing a prefix share the work on that prefix, so the cost is proportional to the
+  // size of the name trie instead of the total length of all names.
+  // Each name gets the same matches in the same order as match() would give.
+  // The walk is fastest when names are already in canonical order; otherwise they are sorted first.
+  void match_all(const std::vector<ndn::Name>& names, const MatchAllCallback& callback);
+
+  // Throws BudgetExceeded if the check takes more work than the limits allow.
   bool check(const ndn::Name& pkt_name, const ndn::Name& key_name);
+
+  // Whether some key name starting with key_prefix may sign pkt_name, e.g. when a key locator
+  // is a key name rather than a certificate name. Components after key_prefix are not checked,
+  // so a true result still needs a check() of the full key name.
+  // Throws BudgetExceeded if the check takes more work than the limits allow.
+  bool check_key_prefix(const ndn::Name& pkt_name, const ndn::Name& key_prefix);
+
+  // Run check(), or check_key_prefix() if key_prefix is set, recording the first max_events steps
+  // of the search: edges taken, constraints failed and sign_cons checked.
+  // Other checks pay one predictable branch per search event for this; meant for failed or slow ones.
+  Explanation explain(const ndn::Name& pkt_name, const ndn::Name& key_name,
+                      size_t max_events = 256, bool key_prefix = false);
+
+private:
+  bool CheckWithBudget(const ndn::Name& pkt_name, const ndn::Name& key_name, bool key_prefix);
+
+  bool check(const ndn::Name& pkt_name, const ndn::Name& key_name, bool key_prefix, Budget& budget);
+
+  bool IsAncestor(uint64_t ancestor, uint64_t node_id) const;
+
+public:
+  // Not safe while other threads check; Validator sets limits before sharing a Checker.
+  void set_limits(const CheckLimits& new_limits) {
+    limits = new_limits;
+  }
+
+  const CheckLimits& get_limits() const {
+    return limits;
+  }
+
+  // The largest number of steps taken by one check() so far
+  size_t get_peak_steps() const {
+    return peak_steps.value.load(std::memory_order_relaxed);
+  }
+
+  // Worst-case search cost of the schema, to find schemas open to adversarial names.
+  SchemaReport analyze() const;
+
+  // Key name templates allowed to sign pkt_name, one per sign_cons of each match of pkt_name,
+  // with the tags captured from pkt_name filled in.
+  // If pkt_prefix is set, pkt_name may also be a prefix of packet names, and the signers of every rule
+  // below it are suggested, without duplicates.
+  std::vector<NameTemplate> suggest_keys(const ndn::Name& pkt_name, bool pkt_prefix = false);
+
+  // Build a name of rule_name from pattern bindings, without trial matching.
+  // Returns std::nullopt if no node of the rule can be fully bound or satisfy its constraints.
+  std::optional<ndn::Name> make_name(const std::string& rule_name,
+                                     const std::map<std::string, ndn::Name::Component>& bindings);
 };
 
 } // namespace lvs
\ No newline at end of file
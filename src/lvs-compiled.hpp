@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstring>
+#include <utility>
+#include "lvs-checker.hpp"
+
+namespace lvs {
+
+// Runtime support for headers emitted by lvs-codegen.
+// A generated header defines a Schema struct with one specialized Node<N>() per LVS node,
+// and CompiledChecker<Schema> wraps it with the same interface as Checker.
+namespace compiled {
+
+using Context = std::vector<std::optional<ndn::Name::Component>>;
+using UserFns = std::map<std::string, UserFn>;
+
+// Visitor is a non-owning reference to the callback invoked on every complete match.
+// Returning true from the callback stops the search.
+class Visitor {
+public:
+  template<typename F>
+  Visitor(F& fn):
+    m_obj(&fn),
+    m_call([](void* obj, uint64_t node_id, Context& context) {
+      return (*static_cast<F*>(obj))(node_id, context);
+    })
+  {}
+
+  bool operator()(uint64_t node_id, Context& context) const {
+    return m_call(m_obj, node_id, context);
+  }
+
+private:
+  void* m_obj;
+  bool (*m_call)(void*, uint64_t, Context&);
+};
+
+inline bool
+LiteralEquals(const ndn::Name::Component& value, uint32_t type, const uint8_t* bytes, size_t length)
+{
+  return value.type() == type && value.value_size() == length &&
+         (length == 0 || std::memcmp(value.value(), bytes, length) == 0);
+}
+
+inline bool
+TagEquals(const ndn::Name::Component& value, const Context& context, uint64_t tag)
+{
+  return context[tag].has_value() && value == *context[tag];
+}
+
+inline ndn::Name::Component
+TagOrEmpty(const Context& context, uint64_t tag)
+{
+  return context[tag].has_value() ? *context[tag] : ndn::Name::Component();
+}
+
+inline bool
+CallUserFn(const UserFns& fns, const std::string& fn_id,
+           const ndn::Name::Component& value, const std::vector<ndn::Name::Component>& args)
+{
+  auto fn = fns.find(fn_id);
+  if(fn == fns.end()) {
+    throw LvsModelError("User function " + fn_id + " is undefined");
+  }
+  return fn->second(value, args);
+}
+
+} // namespace compiled
+
+// CompiledChecker exposes a generated Schema with the same check() and match() as Checker.
+template<typename Schema>
+class CompiledChecker {
+private:
+  std::map<std::string, UserFn> user_fns;
+
+public:
+  using Context = compiled::Context;
+
+  explicit CompiledChecker(std::map<std::string, UserFn> user_fns = {}):
+    user_fns(std::move(user_fns))
+  {}
+
+private:
+  std::map<std::string, ndn::Name::Component> ContextToName(const Context& context) {
+    auto ret = std::map<std::string, ndn::Name::Component>();
+    for(size_t i = 0; i < context.size(); i ++) {
+      if(context[i].has_value()){
+        ret[std::string(Schema::symbols[i])] = *context[i];
+      }
+    }
+    return ret;
+  }
+
+public:
+  // Matches are collected eagerly, since the generated matcher is a recursive DFS.
+  Generator<std::tuple<const std::vector<std::string>*, std::map<std::string, ndn::Name::Component>>>
+  match(const ndn::Name& name) {
+    using Result = std::tuple<const std::vector<std::string>*, std::map<std::string, ndn::Name::Component>>;
+    auto results = std::vector<Result>();
+    auto context = Context(Schema::named_pattern_cnt + 1);
+    auto collect = [&](uint64_t node_id, Context& con) {
+      results.emplace_back(&Schema::RuleName(node_id), ContextToName(con));
+      return false;
+    };
+    Schema::Match(name, context, user_fns, collect);
+    size_t pos = 0;
+    return [results = std::move(results), pos]() mutable -> Result {
+      if(pos >= results.size()) {
+        throw StopIteration();
+      }
+      return results[pos ++];
+    };
+  }
+
+  bool check(const ndn::Name& pkt_name, const ndn::Name& key_name) {
+    auto context = Context(Schema::named_pattern_cnt + 1);
+    auto on_pkt = [&](uint64_t pkt_node, Context& con) {
+      auto on_key = [&](uint64_t key_node, Context&) {
+        return Schema::SignedBy(pkt_node, key_node);
+      };
+      return Schema::Match(key_name, con, user_fns, on_key);
+    };
+    return Schema::Match(pkt_name, context, user_fns, on_pkt);
+  }
+};
+
+} // namespace lvs
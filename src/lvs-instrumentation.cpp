@@ -0,0 +1,215 @@
+#include "lvs-instrumentation.hpp"
+#include <mutex>
+#include <set>
+
+namespace lvs {
+namespace instrumentation {
+
+namespace {
+
+struct Registry {
+  std::mutex mutex;
+  std::set<ThreadCounters*> threads;
+  Snapshot exited;  // Counters of threads that have exited
+  std::map<std::string, uint32_t> ruleIndex;
+  std::vector<std::string> ruleNames;  // By index
+};
+
+// Never destroyed, since threads may exit after static destructors have run
+Registry&
+registry()
+{
+  static auto* instance = new Registry;
+  return *instance;
+}
+
+// Called with the registry locked
+void
+addTo(Snapshot& total, ThreadCounters& counters)
+{
+  for(size_t i = 0; i < COUNTER_COUNT; i ++) {
+    total.values[i] += counters.values[i].load(std::memory_order_relaxed);
+  }
+  auto& names = registry().ruleNames;
+  for(size_t i = 0; i < counters.ruleChunks.size(); i ++) {
+    auto* chunk = counters.ruleChunks[i].load(std::memory_order_acquire);
+    if(chunk == nullptr) {
+      continue;
+    }
+    for(size_t j = 0; j < chunk->size() && i * ThreadCounters::RULE_CHUNK + j < names.size(); j ++) {
+      auto accepted = (*chunk)[j].accepted.load(std::memory_order_relaxed);
+      auto rejected = (*chunk)[j].rejected.load(std::memory_order_relaxed);
+      if(accepted > 0 || rejected > 0) {
+        auto& outcomes = total.rules[names[i * ThreadCounters::RULE_CHUNK + j]];
+        outcomes.accepted += accepted;
+        outcomes.rejected += rejected;
+      }
+    }
+  }
+}
+
+void
+increment(std::atomic<uint64_t>& value)
+{
+  value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+// Owns the counters of a thread
+struct ThreadHandle {
+  ThreadCounters counters;
+
+  ThreadHandle()
+  {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    registry().threads.insert(&counters);
+  }
+
+  ~ThreadHandle()
+  {
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    addTo(reg.exited, counters);
+    reg.threads.erase(&counters);
+  }
+};
+
+} // namespace
+
+const char*
+counterName(Counter counter)
+{
+  static const char* const names[COUNTER_COUNT] = {
+    "checks",
+    "checks_accepted",
+    "checks_unmatched",
+    "edges_tried",
+    "backtracks",
+    "constraint_evals",
+    "user_fn_calls",
+    "validations",
+    "cert_fetches",
+    "signature_verifies",
+    "verify_nanoseconds",
+  };
+  return counter < COUNTER_COUNT ? names[counter] : "unknown";
+}
+
+void
+Snapshot::print(std::ostream& os) const
+{
+  for(size_t i = 0; i < COUNTER_COUNT; i ++) {
+    os << "lvs_" << counterName(Counter(i)) << " " << values[i] << "\n";
+  }
+  for(auto&& [rule, outcomes]: rules) {
+    os << "lvs_rule{" << rule << "} " << outcomes.accepted << " " << outcomes.rejected << "\n";
+  }
+}
+
+uint32_t
+internRule(const std::string& ruleName)
+{
+  auto& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  auto it = reg.ruleIndex.find(ruleName);
+  if(it == reg.ruleIndex.end()) {
+    it = reg.ruleIndex.emplace(ruleName, uint32_t(reg.ruleNames.size())).first;
+    reg.ruleNames.push_back(ruleName);
+  }
+  return it->second;
+}
+
+ThreadCounters::~ThreadCounters()
+{
+  for(auto&& chunk: ruleChunks) {
+    delete chunk.load(std::memory_order_relaxed);
+  }
+}
+
+ThreadCounters::RuleCounter*
+ThreadCounters::rule(uint32_t index)
+{
+  if(index >= MAX_RULES) {
+    return nullptr;
+  }
+  auto& chunk = ruleChunks[index / RULE_CHUNK];
+  auto* rules = chunk.load(std::memory_order_relaxed);
+  if(rules == nullptr) {
+    rules = new RuleChunk();
+    chunk.store(rules, std::memory_order_release);
+  }
+  return &(*rules)[index % RULE_CHUNK];
+}
+
+void
+ThreadCounters::endCheck(bool accepted)
+{
+  // The check stops at the packet node whose signing constraint accepts the key
+  if(accepted) {
+    for(auto index: *triedRules.back()) {
+      if(auto* counter = rule(index)) {
+        increment(counter->accepted);
+      }
+    }
+    return;
+  }
+  // A rule of several packet nodes counts one rejection. The nodes tried may also be inner
+  // nodes of no rule, when the packet name is a prefix of rules.
+  checks ++;
+  bool matched = false;
+  for(auto* rules: triedRules) {
+    matched = matched || !rules->empty();
+    for(auto index: *rules) {
+      auto* counter = rule(index);
+      if(counter != nullptr && counter->lastRejected != checks) {
+        counter->lastRejected = checks;
+        increment(counter->rejected);
+      }
+    }
+  }
+  if(!matched) {
+    add(CHECKS_UNMATCHED, 1);
+  }
+}
+
+ThreadCounters*
+registerThread()
+{
+  thread_local ThreadHandle handle;
+  return &handle.counters;
+}
+
+Snapshot
+snapshot()
+{
+  auto& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  auto total = reg.exited;
+  for(auto* counters: reg.threads) {
+    addTo(total, *counters);
+  }
+  return total;
+}
+
+void
+reset()
+{
+  auto& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  reg.exited = Snapshot();
+  for(auto* counters: reg.threads) {
+    for(auto&& value: counters->values) {
+      value.store(0, std::memory_order_relaxed);
+    }
+    for(auto&& chunk: counters->ruleChunks) {
+      if(auto* rules = chunk.load(std::memory_order_acquire)) {
+        for(auto&& counter: *rules) {
+          counter.accepted.store(0, std::memory_order_relaxed);
+          counter.rejected.store(0, std::memory_order_relaxed);
+        }
+      }
+    }
+  }
+}
+
+} // namespace instrumentation
+} // namespace lvs
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "lvs-cxx-config.hpp"
+
+#if defined(LVS_CXX_HAVE_INSTRUMENTATION) && defined(LVS_CXX_HAVE_SDT)
+#include <sys/sdt.h>
+#endif
+
+namespace lvs {
+namespace instrumentation {
+
+// Counters of the hot paths of Checker and Validator.
+// They are only kept when built with --with-instrumentation; otherwise the LVS_COUNT macros
+// expand to nothing and snapshot() is all zeros.
+enum Counter {
+  CHECKS,               // Checker::check() and check_key_prefix() calls
+  CHECKS_ACCEPTED,
+  CHECKS_UNMATCHED,     // Checks whose packet name matches no rule
+  EDGES_TRIED,          // Value edge lookups and pattern edges tried by the matcher
+  BACKTRACKS,           // Steps back to a parent node
+  CONSTRAINT_EVALS,     // Constraint sets evaluated on a pattern edge
+  USER_FN_CALLS,
+  VALIDATIONS,          // Validator::validate() calls
+  CERT_FETCHES,         // Certificate Interests expressed
+  SIGNATURE_VERIFIES,
+  VERIFY_NANOSECONDS,   // Time spent verifying signatures and checking the policy
+  COUNTER_COUNT
+};
+
+const char*
+counterName(Counter counter);
+
+// Checks decided for packets of one rule. A check is accepted for the rules of the packet node
+// whose signing constraint accepts the key, or rejected once for each rule the packet name matches.
+struct RuleOutcomes {
+  uint64_t accepted = 0;
+  uint64_t rejected = 0;
+};
+
+// Counters summed over all threads, including threads that have exited
+struct Snapshot {
+  std::array<uint64_t, COUNTER_COUNT> values{};
+  std::map<std::string, RuleOutcomes> rules;
+
+  uint64_t
+  operator[](Counter counter) const
+  {
+    return values[counter];
+  }
+
+  // One "name value" line per counter and "rule{name} accepted rejected" per rule
+  void
+  print(std::ostream& os) const;
+};
+
+// Rules are counted by index rather than by name. Checker interns the rule names of its schema
+// when it is built; names after the first MAX_RULES are not counted.
+constexpr uint32_t MAX_RULES = 1 << 16;
+
+uint32_t
+internRule(const std::string& ruleName);
+
+// Counters of one thread. Only the owning thread writes them, so relaxed loads and stores suffice
+// and no instruction locks the bus; snapshot() reads them from another thread.
+struct ThreadCounters {
+  static constexpr size_t RULE_CHUNK = 256;
+
+  struct RuleCounter {
+    std::atomic<uint64_t> accepted{0};
+    std::atomic<uint64_t> rejected{0};
+    uint64_t lastRejected = 0;  // The check that last counted a rejection; owning thread only
+  };
+  using RuleChunk = std::array<RuleCounter, RULE_CHUNK>;
+
+  std::array<std::atomic<uint64_t>, COUNTER_COUNT> values{};
+  // Allocated by the owning thread when a rule is first counted and never moved, so that
+  // snapshot() reads them without a lock
+  std::array<std::atomic<RuleChunk*>, MAX_RULES / RULE_CHUNK> ruleChunks{};
+  // Rules of the packet nodes tried by the check in progress
+  std::vector<const std::vector<uint32_t>*> triedRules;
+  uint64_t checks = 0;
+
+  ThreadCounters() = default;
+  ~ThreadCounters();
+
+  ThreadCounters(const ThreadCounters&) = delete;
+  ThreadCounters& operator=(const ThreadCounters&) = delete;
+
+  void
+  add(Counter counter, uint64_t n)
+  {
+    auto& value = values[counter];
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  void
+  beginCheck()
+  {
+    triedRules.clear();
+  }
+
+  void
+  tryRules(const std::vector<uint32_t>& rules)
+  {
+    triedRules.push_back(&rules);
+  }
+
+  // Count the outcome of the check against the rules tried since beginCheck()
+  void
+  endCheck(bool accepted);
+
+private:
+  // nullptr past MAX_RULES
+  RuleCounter*
+  rule(uint32_t index);
+};
+
+// Registers the counters of the calling thread, which are folded into the totals when it exits
+ThreadCounters*
+registerThread();
+
+inline ThreadCounters&
+local()
+{
+  thread_local ThreadCounters* counters = registerThread();
+  return *counters;
+}
+
+// Adds the lifetime of the object to a counter in nanoseconds
+class ScopedTimer {
+public:
+  explicit ScopedTimer(Counter counter):
+    m_counter(counter), m_start(std::chrono::steady_clock::now())
+  {
+  }
+
+  ~ScopedTimer()
+  {
+    auto elapsed = std::chrono::steady_clock::now() - m_start;
+    local().add(m_counter, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+  Counter m_counter;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+// Aggregate the counters of all threads
+Snapshot
+snapshot();
+
+// Zero all counters. Increments racing with it may be lost.
+void
+reset();
+
+// Whether the library was built with instrumentation
+constexpr bool
+enabled()
+{
+#ifdef LVS_CXX_HAVE_INSTRUMENTATION
+  return true;
+#else
+  return false;
+#endif
+}
+
+} // namespace instrumentation
+} // namespace lvs
+
+#ifdef LVS_CXX_HAVE_INSTRUMENTATION
+#define LVS_COUNT(counter, n) ::lvs::instrumentation::local().add(::lvs::instrumentation::counter, (n))
+#define LVS_CHECK_BEGIN() ::lvs::instrumentation::local().beginCheck()
+#define LVS_CHECK_RULES(rules) ::lvs::instrumentation::local().tryRules(rules)
+#define LVS_CHECK_END(accepted) ::lvs::instrumentation::local().endCheck(accepted)
+#define LVS_TIME_SCOPE(counter) ::lvs::instrumentation::ScopedTimer lvs_scoped_timer(::lvs::instrumentation::counter)
+#else
+#define LVS_COUNT(counter, n) do {} while(false)
+#define LVS_CHECK_BEGIN() do {} while(false)
+#define LVS_CHECK_RULES(rules) do {} while(false)
+#define LVS_CHECK_END(accepted) do {} while(false)
+#define LVS_TIME_SCOPE(counter) do {} while(false)
+#endif
+
+// USDT probes of provider "lvs", for perf and bpftrace. A probe is a nop until a tracer attaches.
+// Names are passed as the TLV wire and its size, so a tracer can read them:
+//   match_start(name, size)  match_end(name, result, steps)  result is 1, 0, or -1 on budget exceeded
+//   fetch_start(name, size)  fetch_end(name, how)            how is 0 for Data, 1 for Nack, 2 for timeout
+// The *_end name is the same buffer as its *_start, so it also pairs the two.
+#if defined(LVS_CXX_HAVE_INSTRUMENTATION) && defined(LVS_CXX_HAVE_SDT)
+#define LVS_PROBE2(name, a, b) DTRACE_PROBE2(lvs, name, a, b)
+#define LVS_PROBE3(name, a, b, c) DTRACE_PROBE3(lvs, name, a, b, c)
+#else
+#define LVS_PROBE2(name, a, b) do {} while(false)
+#define LVS_PROBE3(name, a, b, c) do {} while(false)
+#endif
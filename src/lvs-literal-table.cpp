@@ -0,0 +1,176 @@
+#include "lvs-literal-table.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LVS_LITERAL_TABLE_X86 1
+#else
+#define LVS_LITERAL_TABLE_X86 0
+#endif
+
+namespace lvs {
+
+using Prefix = LiteralTable::Prefix;
+
+namespace {
+
+// A kernel returns the index of the first prefix at or after start equal to key, or count.
+using KernelFn = size_t (*)(const Prefix* prefixes, size_t count, const Prefix& key, size_t start);
+
+size_t
+FindScalar(const Prefix* prefixes, size_t count, const Prefix& key, size_t start)
+{
+  uint64_t key_lo, key_hi;
+  std::memcpy(&key_lo, key.bytes, 8);
+  std::memcpy(&key_hi, key.bytes + 8, 8);
+  for(size_t i = start; i < count; i ++) {
+    uint64_t lo, hi;
+    std::memcpy(&lo, prefixes[i].bytes, 8);
+    std::memcpy(&hi, prefixes[i].bytes + 8, 8);
+    if(((lo ^ key_lo) | (hi ^ key_hi)) == 0) {
+      return i;
+    }
+  }
+  return count;
+}
+
+#if LVS_LITERAL_TABLE_X86
+
+__attribute__((target("sse2"))) size_t
+FindSse2(const Prefix* prefixes, size_t count, const Prefix& key, size_t start)
+{
+  auto needle = _mm_load_si128(reinterpret_cast<const __m128i*>(key.bytes));
+  for(size_t i = start; i < count; i ++) {
+    auto entry = _mm_load_si128(reinterpret_cast<const __m128i*>(prefixes[i].bytes));
+    if(_mm_movemask_epi8(_mm_cmpeq_epi8(entry, needle)) == 0xFFFF) {
+      return i;
+    }
+  }
+  return count;
+}
+
+// Compares two literals per instruction.
+__attribute__((target("avx2"))) size_t
+FindAvx2(const Prefix* prefixes, size_t count, const Prefix& key, size_t start)
+{
+  auto half = _mm_load_si128(reinterpret_cast<const __m128i*>(key.bytes));
+  auto needle = _mm256_broadcastsi128_si256(half);
+  size_t i = start;
+  for(; i + 2 <= count; i += 2) {
+    auto entries = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prefixes[i].bytes));
+    uint32_t mask = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(entries, needle)));
+    if((mask & 0xFFFF) == 0xFFFF) {
+      return i;
+    }
+    if((mask >> 16) == 0xFFFF) {
+      return i + 1;
+    }
+  }
+  return FindSse2(prefixes, count, key, i);
+}
+
+#endif // LVS_LITERAL_TABLE_X86
+
+KernelFn
+GetKernel(LiteralTable::Kernel kernel)
+{
+  switch(kernel) {
+#if LVS_LITERAL_TABLE_X86
+  case LiteralTable::Kernel::AVX2:
+    return FindAvx2;
+  case LiteralTable::Kernel::SSE2:
+    return FindSse2;
+#endif
+  default:
+    return FindScalar;
+  }
+}
+
+} // namespace
+
+LiteralTable::Kernel
+LiteralTable::BestKernel()
+{
+#if LVS_LITERAL_TABLE_X86
+  static const Kernel best = [] {
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+      return Kernel::AVX2;
+    } else if(__builtin_cpu_supports("sse2")) {
+      return Kernel::SSE2;
+    }
+    return Kernel::SCALAR;
+  }();
+  return best;
+#else
+  return Kernel::SCALAR;
+#endif
+}
+
+bool
+LiteralTable::insert(const tlv::NameComponent& literal, size_t id)
+{
+  auto [type, tsiz] = tlv::TlvVar::Parse(literal);
+  if(!type.has_value()) {
+    return false;
+  }
+  auto [length, lsiz] = tlv::TlvVar::Parse(literal.substr(tsiz));
+  if(!length.has_value() || tsiz + lsiz + *length != literal.size()) {
+    return false;
+  }
+  auto value = literal.data() + tsiz + lsiz;
+  if(find(*type, value, *length, Kernel::SCALAR).has_value()) {
+    return true;
+  }
+
+  auto group = groups.begin();
+  for(; group != groups.end(); group ++) {
+    if(group->type == *type && group->length == *length) {
+      break;
+    }
+  }
+  if(group == groups.end()) {
+    group = groups.insert(groups.end(), Group{*type, *length, {}, {}, {}});
+  }
+
+  Prefix prefix{};
+  if(*length > 0) {
+    std::memcpy(prefix.bytes, value, std::min<size_t>(*length, PREFIX_SIZE));
+  }
+  group->prefixes.push_back(prefix);
+  if(*length > PREFIX_SIZE) {
+    group->tails.insert(group->tails.end(), value + PREFIX_SIZE, value + *length);
+  }
+  group->ids.push_back(id);
+  return true;
+}
+
+std::optional<size_t>
+LiteralTable::find(uint64_t type, const uint8_t* value, size_t length, Kernel kernel) const
+{
+  for(auto&& group: groups) {
+    if(group.type != type || group.length != length) {
+      continue;
+    }
+    Prefix key{};
+    if(length > 0) {
+      std::memcpy(key.bytes, value, std::min(length, PREFIX_SIZE));
+    }
+    auto kernel_fn = GetKernel(kernel);
+    auto count = group.prefixes.size();
+    auto tail_size = length > PREFIX_SIZE ? length - PREFIX_SIZE : 0;
+    for(size_t i = kernel_fn(group.prefixes.data(), count, key, 0);
+        i < count;
+        i = kernel_fn(group.prefixes.data(), count, key, i + 1)) {
+      if(tail_size == 0 ||
+         std::memcmp(&group.tails[i * tail_size], value + PREFIX_SIZE, tail_size) == 0) {
+        return group.ids[i];
+      }
+    }
+    return std::nullopt;
+  }
+  return std::nullopt;
+}
+
+} // namespace lvs
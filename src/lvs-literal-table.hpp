@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include <ndn-cxx/name.hpp>
+#include "tlv-encoder.hpp"
+
+namespace lvs {
+
+// LiteralTable finds a name component among a set of literals.
+// Literals are grouped by TLV type and length, and the first PREFIX_SIZE bytes of each value
+// are packed into an aligned table, so a candidate is compared against every literal of the
+// same type and length with a few vector instructions instead of one Component comparison each.
+class LiteralTable {
+public:
+  static constexpr size_t PREFIX_SIZE = 16;
+
+  enum class Kernel {
+    SCALAR,
+    SSE2,
+    AVX2,
+  };
+
+  struct alignas(PREFIX_SIZE) Prefix {
+    uint8_t bytes[PREFIX_SIZE];
+  };
+
+  // Add a literal in TLV wire format with the id to return on a match.
+  // If the same literal is added twice, the first id wins.
+  // Returns false if the literal is not a well-formed TLV block.
+  bool insert(const tlv::NameComponent& literal, size_t id);
+
+  bool empty() const {
+    return groups.empty();
+  }
+
+  // Returns the id of the matching literal, if any.
+  std::optional<size_t> find(const ndn::Name::Component& value) const {
+    return find(value.type(), value.value(), value.value_size(), kernel);
+  }
+
+  std::optional<size_t> find(uint64_t type, const uint8_t* value, size_t length, Kernel kernel) const;
+
+  // The fastest kernel supported by the running CPU.
+  static Kernel BestKernel();
+
+private:
+  struct Group {
+    uint64_t type;
+    size_t length;
+    std::vector<Prefix> prefixes;  // Zero padded when length < PREFIX_SIZE
+    std::vector<uint8_t> tails;    // Bytes after the prefix, (length - PREFIX_SIZE) per literal
+    std::vector<size_t> ids;
+  };
+
+  std::vector<Group> groups;
+  Kernel kernel = BestKernel();
+};
+
+} // namespace lvs
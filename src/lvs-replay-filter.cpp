@@ -0,0 +1,80 @@
+#include "lvs-replay-filter.hpp"
+#include <algorithm>
+
+namespace lvs {
+
+ReplayFilter::ReplayFilter(size_t maxKeys, ndn::time::nanoseconds gracePeriod, size_t maxNonces):
+  m_maxKeys(maxKeys), m_gracePeriod(gracePeriod), m_maxNonces(maxNonces)
+{
+}
+
+bool
+ReplayFilter::check(const ndn::Name& keyName, const Stamp& stamp) const
+{
+  if(!stamp.time.has_value() && !stamp.seqNum.has_value() && !stamp.nonce.has_value()){
+    return false;
+  }
+  if(stamp.time.has_value() && m_gracePeriod > ndn::time::nanoseconds::zero()){
+    auto now = ndn::time::system_clock::now();
+    if(*stamp.time < now - m_gracePeriod || *stamp.time > now + m_gracePeriod){
+      return false;
+    }
+  }
+
+  auto it = m_records.find(keyName);
+  if(it == m_records.end()){
+    return true;
+  }
+  auto& record = it->second;
+  if(stamp.time.has_value() && record.time.has_value() && *stamp.time <= *record.time){
+    return false;
+  }
+  if(stamp.seqNum.has_value() && record.seqNum.has_value() && *stamp.seqNum <= *record.seqNum){
+    return false;
+  }
+  if(stamp.nonce.has_value() &&
+     std::find(record.nonces.begin(), record.nonces.end(), *stamp.nonce) != record.nonces.end()){
+    return false;
+  }
+  return true;
+}
+
+bool
+ReplayFilter::insert(const ndn::Name& keyName, const Stamp& stamp)
+{
+  if(!check(keyName, stamp)){
+    return false;
+  }
+  if(m_maxKeys == 0){
+    return true;
+  }
+
+  auto it = m_records.find(keyName);
+  if(it == m_records.end()){
+    m_lru.push_front(keyName);
+    it = m_records.emplace(keyName, Record{std::nullopt, std::nullopt, {}, m_lru.begin()}).first;
+    while(m_records.size() > m_maxKeys){
+      m_records.erase(m_lru.back());
+      m_lru.pop_back();
+    }
+  }else{
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+  }
+
+  auto& record = it->second;
+  if(stamp.time.has_value()){
+    record.time = stamp.time;
+  }
+  if(stamp.seqNum.has_value()){
+    record.seqNum = stamp.seqNum;
+  }
+  if(stamp.nonce.has_value() && m_maxNonces > 0){
+    record.nonces.push_back(*stamp.nonce);
+    if(record.nonces.size() > m_maxNonces){
+      record.nonces.pop_front();
+    }
+  }
+  return true;
+}
+
+} // namespace lvs
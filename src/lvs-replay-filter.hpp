@@ -0,0 +1,58 @@
+#pragma once
+
+#include <deque>
+#include <list>
+#include <map>
+#include <optional>
+#include <vector>
+#include "ndn-cxx/name.hpp"
+#include "ndn-cxx/util/time.hpp"
+
+namespace lvs {
+
+// ReplayFilter rejects signed Interests that repeat an earlier one or are too far from the present.
+// For each signing key it keeps the latest timestamp and sequence number and a few recent nonces.
+// It keeps a bounded number of keys, evicting the least recently used, so memory stays bounded.
+class ReplayFilter {
+public:
+  // The fields of a signed Interest that protect it from replay; each may be absent
+  struct Stamp {
+    std::optional<ndn::time::system_clock::time_point> time;
+    std::optional<uint64_t> seqNum;
+    std::optional<std::vector<uint8_t>> nonce;
+  };
+
+  // A zero gracePeriod accepts any timestamp; zero maxKeys or maxNonces keeps no such state.
+  ReplayFilter(size_t maxKeys, ndn::time::nanoseconds gracePeriod, size_t maxNonces);
+
+  // Whether an Interest signed by keyName with stamp would be accepted. Nothing is recorded.
+  // An Interest with none of the fields could be replayed at will, so it is never accepted.
+  bool
+  check(const ndn::Name& keyName, const Stamp& stamp) const;
+
+  // Accept and record an Interest, or return false if check() rejects it.
+  bool
+  insert(const ndn::Name& keyName, const Stamp& stamp);
+
+  size_t
+  size() const
+  {
+    return m_records.size();
+  }
+
+private:
+  struct Record {
+    std::optional<ndn::time::system_clock::time_point> time;
+    std::optional<uint64_t> seqNum;
+    std::deque<std::vector<uint8_t>> nonces;  // Oldest first
+    std::list<ndn::Name>::iterator lru;
+  };
+
+  size_t m_maxKeys;
+  ndn::time::nanoseconds m_gracePeriod;
+  size_t m_maxNonces;
+  std::map<ndn::Name, Record> m_records;
+  std::list<ndn::Name> m_lru;  // Most recently used first
+};
+
+} // namespace lvs
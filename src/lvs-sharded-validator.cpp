@@ -0,0 +1,154 @@
+#include "lvs-sharded-validator.hpp"
+#include "ndn-cxx/util/logger.hpp"
+#include <boost/asio/post.hpp>
+#include <limits>
+
+namespace lvs {
+
+using tlv::bstring_view;
+
+NDN_LOG_INIT(lvs.ShardedValidator);
+
+ShardedValidator::ShardedValidator(const bstring_view& binary_lvs,
+                                   const std::vector<ndn::security::Certificate>& trust_anchors,
+                                   size_t shards,
+                                   const ValidatorOptions& options,
+                                   const FaceFactory& makeFace):
+  m_options(options)
+{
+  auto schema = Validator::parseSchema(binary_lvs, 1, {});
+  schema->sharedCerts = std::make_shared<ConcurrentCertCache>(options.certCacheCapacity,
+                                                              options.certCacheLifetime);
+  m_schema = schema;
+
+  // Each shard keeps few certificates of its own; the shared cache holds the rest
+  ValidatorOptions shardOptions = options;
+  shardOptions.certCacheCapacity = std::min<size_t>(options.certCacheCapacity, 64);
+
+  for(size_t i = 0; i < std::max<size_t>(shards, 1); i ++){
+    auto shard = std::make_unique<Shard>();
+    shard->work.emplace(shard->io);
+    shard->face = makeFace ? makeFace(shard->io) : std::make_unique<ndn::Face>(shard->io);
+    if(!options.certStorePath.empty()){
+      shardOptions.certStorePath = options.certStorePath + "." + std::to_string(i);
+    }
+    shard->validator.reset(new Validator(m_schema, *shard->face, trust_anchors, shardOptions));
+    m_shards.push_back(std::move(shard));
+  }
+
+  // Threads start only when every shard is built, so none runs while m_shards grows
+  for(auto& shard: m_shards){
+    shard->thread = std::thread([io = &shard->io]{
+      io->run();
+    });
+  }
+  NDN_LOG_INFO("Started " << m_shards.size() << " validator shards");
+}
+
+ShardedValidator::~ShardedValidator()
+{
+  for(auto& shard: m_shards){
+    shard->work.reset();
+    shard->io.stop();
+  }
+  for(auto& shard: m_shards){
+    if(shard->thread.joinable()){
+      shard->thread.join();
+    }
+  }
+  // The validator refers to the face, so it goes first
+  for(auto& shard: m_shards){
+    shard->validator.reset();
+    shard->face.reset();
+  }
+}
+
+size_t
+ShardedValidator::getShardIndex(const ndn::Data& data) const
+{
+  auto keyLocator = data.getKeyLocator();
+  if(!keyLocator.has_value()){
+    return 0;
+  }
+  return std::hash<ndn::Name>()(keyNameOf(keyLocator->getName())) % m_shards.size();
+}
+
+void
+ShardedValidator::validate(const ndn::Data& data,
+                           const ndn::security::DataValidationSuccessCallback& successCb,
+                           const ndn::security::DataValidationFailureCallback& failureCb,
+                           ValidationPriority priority)
+{
+  auto& shard = *m_shards[getShardIndex(data)];
+  boost::asio::post(shard.io, [validator = shard.validator.get(), data, successCb, failureCb, priority]{
+    validator->validate(data, successCb, failureCb, priority);
+  });
+}
+
+void
+ShardedValidator::forEachShard(const std::function<void(Validator&)>& fn)
+{
+  for(auto& shard: m_shards){
+    boost::asio::post(shard->io, [validator = shard->validator.get(), fn]{
+      fn(*validator);
+    });
+  }
+}
+
+uint64_t
+ShardedValidator::reloadSchema(const bstring_view& binary_lvs)
+{
+  auto version = m_lastVersion.fetch_add(1) + 1;
+  auto schema = Validator::parseSchema(binary_lvs, version, {});
+  // Certificates verified under the old schema are not shared with the new one
+  schema->sharedCerts = std::make_shared<ConcurrentCertCache>(m_options.certCacheCapacity,
+                                                              m_options.certCacheLifetime);
+  {
+    std::lock_guard<std::mutex> lock(m_schemaMutex);
+    if(m_schema->version < version){
+      m_schema = schema;
+    }
+  }
+  Validator::SchemaPtr installed = schema;
+  forEachShard([installed](Validator& validator){
+    validator.installSchema(installed);
+  });
+  return version;
+}
+
+uint64_t
+ShardedValidator::getSchemaVersion() const
+{
+  uint64_t ret = std::numeric_limits<uint64_t>::max();
+  for(auto& shard: m_shards){
+    ret = std::min(ret, shard->validator->getSchemaVersion());
+  }
+  return ret;
+}
+
+void
+ShardedValidator::addTrustAnchor(const ndn::security::Certificate& anchor)
+{
+  forEachShard([anchor](Validator& validator){
+    validator.addTrustAnchor(anchor);
+  });
+}
+
+void
+ShardedValidator::removeTrustAnchor(const ndn::Name& anchorName)
+{
+  // Each shard also clears the shared cache, so no certificate verified through the anchor
+  // by a shard that had not removed it yet survives
+  forEachShard([anchorName](Validator& validator){
+    validator.removeTrustAnchor(anchorName);
+  });
+}
+
+CertCache::Stats
+ShardedValidator::getCertCacheStats() const
+{
+  std::lock_guard<std::mutex> lock(m_schemaMutex);
+  return m_schema->sharedCerts->getStats();
+}
+
+} // namespace lvs
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include <boost/asio/io_service.hpp>
+#include "lvs-validator.hpp"
+
+namespace lvs {
+
+// ShardedValidator spreads validation over several threads, each running its own Validator
+// with its own Face and io context.
+// The shards share one parsed schema and one cache of verified certificates. Data is routed to
+// a shard by the key name of its key locator, so the certificate of each key is fetched by one shard only.
+class ShardedValidator {
+public:
+  // Creates the face of a shard. By default, each shard has a Face connected to the local forwarder.
+  using FaceFactory = std::function<std::unique_ptr<ndn::Face>(boost::asio::io_service&)>;
+
+  // options apply to each shard. A certStorePath gets the shard index appended, since each shard
+  // stores the certificates of its own keys.
+  ShardedValidator(const tlv::bstring_view& binary_lvs,
+                   const std::vector<ndn::security::Certificate>& trust_anchors,
+                   size_t shards,
+                   const ValidatorOptions& options = {},
+                   const FaceFactory& makeFace = nullptr);
+
+  // Stops the shard threads. Validations not finished by then fail with VALIDATION_OVERLOADED
+  // on the calling thread; see ~Validator.
+  ~ShardedValidator();
+
+  ShardedValidator(const ShardedValidator&) = delete;
+  ShardedValidator& operator=(const ShardedValidator&) = delete;
+
+  // May be called from any thread. The callbacks run on the thread of the shard.
+  void
+  validate(const ndn::Data& data,
+           const ndn::security::DataValidationSuccessCallback& successCb,
+           const ndn::security::DataValidationFailureCallback& failureCb,
+           ValidationPriority priority = ValidationPriority::NORMAL);
+
+  // The shard that validates data
+  size_t
+  getShardIndex(const ndn::Data& data) const;
+
+  size_t
+  size() const
+  {
+    return m_shards.size();
+  }
+
+  // Replace the trust schema of every shard; see Validator::reloadSchema.
+  uint64_t
+  reloadSchema(const tlv::bstring_view& binary_lvs);
+
+  // The schema version active on every shard
+  uint64_t
+  getSchemaVersion() const;
+
+  void
+  addTrustAnchor(const ndn::security::Certificate& anchor);
+
+  void
+  removeTrustAnchor(const ndn::Name& anchorName);
+
+  // Statistics of the certificate cache shared by the shards
+  CertCache::Stats
+  getCertCacheStats() const;
+
+private:
+  struct Shard {
+    boost::asio::io_service io;
+    std::optional<boost::asio::io_service::work> work;
+    std::unique_ptr<ndn::Face> face;
+    std::unique_ptr<Validator> validator;
+    std::thread thread;
+  };
+
+  // Run fn with the Validator of every shard, each on its own thread.
+  void
+  forEachShard(const std::function<void(Validator&)>& fn);
+
+private:
+  ValidatorOptions m_options;
+  std::vector<std::unique_ptr<Shard>> m_shards;
+  std::atomic<uint64_t> m_lastVersion{1};
+  // Only guards the schema of control calls; validate() does not take it
+  mutable std::mutex m_schemaMutex;
+  Validator::SchemaPtr m_schema;
+};
+
+} // namespace lvs
@@ -0,0 +1,58 @@
+#include "lvs-thread-pool.hpp"
+
+namespace lvs {
+
+ThreadPool::ThreadPool(size_t threads, size_t maxQueued):
+  m_maxQueued(maxQueued)
+{
+  for(size_t i = 0; i < threads; i ++){
+    m_threads.emplace_back([this]{ run(); });
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopped = true;
+    m_queue.clear();
+  }
+  m_cv.notify_all();
+  for(auto& thread: m_threads){
+    thread.join();
+  }
+}
+
+bool
+ThreadPool::submit(std::function<void()> job)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_stopped || m_queue.size() >= m_maxQueued){
+      return false;
+    }
+    m_queue.push_back(std::move(job));
+  }
+  m_cv.notify_one();
+  return true;
+}
+
+void
+ThreadPool::run()
+{
+  while(true){
+    std::function<void()> job;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv.wait(lock, [this]{ return m_stopped || !m_queue.empty(); });
+      if(m_stopped){
+        return;
+      }
+      job = std::move(m_queue.front());
+      m_queue.pop_front();
+    }
+    job();
+  }
+}
+
+} // namespace lvs
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lvs {
+
+// ThreadPool runs jobs on a fixed set of threads from a bounded queue.
+class ThreadPool {
+public:
+  ThreadPool(size_t threads, size_t maxQueued);
+
+  // Queued jobs are dropped; running jobs are waited for.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Queue a job. Returns false if the queue is full.
+  bool
+  submit(std::function<void()> job);
+
+  size_t
+  size() const
+  {
+    return m_threads.size();
+  }
+
+private:
+  void
+  run();
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<std::function<void()>> m_queue;
+  size_t m_maxQueued;
+  bool m_stopped = false;
+  std::vector<std::thread> m_threads;
+};
+
+} // namespace lvs
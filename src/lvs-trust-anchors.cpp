@@ -0,0 +1,90 @@
+#include "lvs-trust-anchors.hpp"
+
+namespace lvs {
+
+void
+TrustAnchorSet::insert(const ndn::security::Certificate& anchor)
+{
+  erase(anchor.getName());
+
+  auto node = &m_root;
+  node->count ++;
+  for(auto&& comp: anchor.getName()){
+    auto& child = node->children[comp];
+    if(child == nullptr){
+      child = std::make_unique<Node>();
+    }
+    node = child.get();
+    node->count ++;
+  }
+  node->anchor = std::make_shared<const ndn::security::Certificate>(anchor);
+}
+
+bool
+TrustAnchorSet::erase(const ndn::Name& certName)
+{
+  auto path = std::vector<Node*>{&m_root};
+  for(auto&& comp: certName){
+    auto it = path.back()->children.find(comp);
+    if(it == path.back()->children.end()){
+      return false;
+    }
+    path.push_back(it->second.get());
+  }
+  if(path.back()->anchor == nullptr){
+    return false;
+  }
+  path.back()->anchor = nullptr;
+
+  for(auto node: path){
+    node->count --;
+  }
+  // Prune the branch that no longer leads to any anchor
+  for(size_t i = certName.size(); i > 0; i --){
+    if(path[i]->count == 0){
+      path[i - 1]->children.erase(certName[i - 1]);
+    }
+  }
+  return true;
+}
+
+std::shared_ptr<const ndn::security::Certificate>
+TrustAnchorSet::find(const ndn::Name& keyLocator) const
+{
+  auto node = &m_root;
+  for(auto&& comp: keyLocator){
+    auto it = node->children.find(comp);
+    if(it == node->children.end()){
+      return nullptr;
+    }
+    node = it->second.get();
+  }
+  // Every node left in the trie leads to an anchor
+  while(node->anchor == nullptr){
+    if(node->children.empty()){
+      return nullptr;
+    }
+    node = node->children.rbegin()->second.get();
+  }
+  return node->anchor;
+}
+
+std::vector<std::shared_ptr<const ndn::security::Certificate>>
+TrustAnchorSet::list() const
+{
+  std::vector<std::shared_ptr<const ndn::security::Certificate>> ret;
+  auto stack = std::vector<const Node*>{&m_root};
+  while(!stack.empty()){
+    auto node = stack.back();
+    stack.pop_back();
+    if(node->anchor != nullptr){
+      ret.push_back(node->anchor);
+    }
+    for(auto it = node->children.rbegin(); it != node->children.rend(); it ++){
+      stack.push_back(it->second.get());
+    }
+  }
+  return ret;
+}
+
+} // namespace lvs
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+#include "ndn-cxx/security/certificate.hpp"
+
+namespace lvs {
+
+// TrustAnchorSet indexes trust anchor certificates in a name trie, so that finding the anchor
+// named by a key locator walks the key locator once, whatever the number of anchors.
+class TrustAnchorSet {
+public:
+  // Add an anchor, replacing any with the same name.
+  void
+  insert(const ndn::security::Certificate& anchor);
+
+  // Returns whether an anchor was removed.
+  bool
+  erase(const ndn::Name& certName);
+
+  // An anchor whose name starts with keyLocator, which can be either a key name or a certificate name.
+  // If several anchors match, the last one in canonical order, i.e. usually the latest version, is returned.
+  std::shared_ptr<const ndn::security::Certificate>
+  find(const ndn::Name& keyLocator) const;
+
+  std::vector<std::shared_ptr<const ndn::security::Certificate>>
+  list() const;
+
+  size_t
+  size() const
+  {
+    return m_root.count;
+  }
+
+private:
+  struct Node {
+    std::map<ndn::Name::Component, std::unique_ptr<Node>> children;
+    std::shared_ptr<const ndn::security::Certificate> anchor;
+    size_t count = 0;  // Anchors in the subtree
+  };
+
+  Node m_root;
+};
+
+} // namespace lvs
@@ -0,0 +1,98 @@
+#pragma once
+
+// co_await support for Validator. Include it only from code built as C++20; lvs-validator.hpp
+// declares the same Validator in every translation unit whatever the language version.
+#if !defined(__cpp_impl_coroutine) || __cpp_impl_coroutine < 201902L
+#error "lvs-validator-coro.hpp needs C++20 coroutines"
+#endif
+
+#include <coroutine>
+#include <optional>
+#include "lvs-validator.hpp"
+
+namespace lvs {
+
+// Outcome of an awaited validation
+struct ValidationResult {
+  std::optional<ndn::security::ValidationError> error;
+
+  explicit operator bool() const
+  {
+    return !error.has_value();
+  }
+};
+
+// ValidationAwaiter is what co_validate() returns to co_await.
+// It lives in the frame of the awaiting coroutine and holds the result there, so awaiting adds
+// no allocation to the validation; pooling the frames is up to the promise type of the caller.
+class ValidationAwaiter {
+public:
+  ValidationAwaiter(Validator& validator, const ndn::Data& data, ValidationPriority priority):
+    m_validator(validator), m_data(data), m_priority(priority)
+  {
+  }
+
+  ValidationAwaiter(const ValidationAwaiter&) = delete;
+  ValidationAwaiter& operator=(const ValidationAwaiter&) = delete;
+
+  bool
+  await_ready() const noexcept
+  {
+    return false;
+  }
+
+  bool
+  await_suspend(std::coroutine_handle<> handle)
+  {
+    m_handle = handle;
+    m_suspending = true;
+    m_validator.validate(m_data,
+      [this](const ndn::Data&){
+        finish();
+      },
+      [this](const ndn::Data&, const ndn::security::ValidationError& error){
+        m_result.error = error;
+        finish();
+      },
+      m_priority);
+    m_suspending = false;
+    // A validation that finished at once, e.g. on a cached result, continues without suspending
+    return !m_done;
+  }
+
+  ValidationResult
+  await_resume()
+  {
+    return std::move(m_result);
+  }
+
+private:
+  void
+  finish()
+  {
+    m_done = true;
+    if(!m_suspending){
+      m_handle.resume();
+    }
+  }
+
+private:
+  Validator& m_validator;
+  const ndn::Data& m_data;
+  ValidationPriority m_priority;
+  std::coroutine_handle<> m_handle;
+  ValidationResult m_result;
+  bool m_suspending = false;
+  bool m_done = false;
+};
+
+// co_await co_validate(validator, data) gives a ValidationResult.
+// data must outlive the co_await; the awaiting coroutine resumes on the face thread.
+inline ValidationAwaiter
+co_validate(Validator& validator, const ndn::Data& data,
+            ValidationPriority priority = ValidationPriority::NORMAL)
+{
+  return ValidationAwaiter(validator, data, priority);
+}
+
+} // namespace lvs
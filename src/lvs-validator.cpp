@@ -1,8 +1,10 @@
 #include "lvs-validator.hpp"
+#include "lvs-instrumentation.hpp"
 #include "ndn-cxx/face.hpp"
 #include "ndn-cxx/util/logger.hpp"
 #include "ndn-cxx/security/verification-helpers.hpp"
-
+#include <boost/asio/post.hpp>
+#include <algorithm>
 
 namespace lvs {
 
@@ -11,78 +13,753 @@ using namespace std;
 
 NDN_LOG_INIT(lvs.Validator);
 
+template<typename Fn>
+void
+Validator::postGuarded(Fn&& fn)
+{
+  boost::asio::post(m_face.getIoService(), [alive = std::weak_ptr<bool>(m_alive), fn = std::forward<Fn>(fn)]{
+    if(!alive.expired()){
+      fn();
+    }
+  });
+}
+
 Validator::Validator(const bstring_view& binary_lvs,
                      ndn::Face& face,
-                     const ndn::security::Certificate& trust_anchor):
-  m_binary_lvs(binary_lvs.begin(), binary_lvs.end()),
-  m_checker(nullptr), m_face(face), m_anchor(trust_anchor)
+                     const ndn::security::Certificate& trust_anchor,
+                     const ValidatorOptions& options):
+  Validator(binary_lvs, face, std::vector<ndn::security::Certificate>{trust_anchor}, options)
+{
+}
+
+Validator::Validator(const bstring_view& binary_lvs,
+                     ndn::Face& face,
+                     const std::vector<ndn::security::Certificate>& trust_anchors,
+                     const ValidatorOptions& options):
+  Validator(parseSchema(binary_lvs, 1, {}), face, trust_anchors, options)
+{
+}
+
+Validator::Validator(SchemaPtr schema,
+                     ndn::Face& face,
+                     const std::vector<ndn::security::Certificate>& trust_anchors,
+                     const ValidatorOptions& options):
+  m_schema(std::move(schema)),
+  m_activeVersion(m_schema->version), m_lastVersion(m_schema->version),
+  m_explainEvents(options.explainEvents),
+  m_face(face),
+  m_options(options),
+  m_certCache(options.certCacheCapacity, options.certCacheLifetime),
+  m_keyCache(options.publicKeyCacheCapacity),
+  m_negativeCache(options.negativeCacheCapacity),
+  m_resultCache(options.resultCacheCapacity),
+  m_replayFilter(options.interestReplayKeys, options.interestGracePeriod, options.interestReplayNonces)
 {
-  auto model = lvs::LvsModel::Parse(bstring_view(m_binary_lvs.data(), m_binary_lvs.size()));
+  for(auto&& anchor: trust_anchors) {
+    m_anchors.insert(anchor);
+  }
+
+  if(!options.certStorePath.empty()) {
+    m_certStore = std::make_unique<CertStore>(options.certStorePath);
+    for(auto&& record: m_certStore->load()) {
+      m_storedCerts.emplace(record.cert.getName(), std::move(record.cert));
+    }
+    NDN_LOG_INFO("Loaded " << m_storedCerts.size() << " certificates from " << options.certStorePath);
+    if(!m_storedCerts.empty()) {
+      postGuarded([this]{ revalidateStored(); });
+    }
+  }
+
+  if(options.workerThreads > 0) {
+    m_workers = std::make_unique<ThreadPool>(options.workerThreads, options.workerQueueDepth);
+  }
+}
+
+Validator::~Validator()
+{
+  m_alive.reset();
+  // Waits for running jobs and drops queued ones. What they posted back finds m_alive gone.
+  m_workers.reset();
+
+  // Each validation not finished gets its failure callback. Certificates are only validated
+  // for the packets waiting on them, which are failed instead.
+  std::vector<StatePtr> unfinished(m_workerStates.begin(), m_workerStates.end());
+  for(auto&& [keyLocator, pending]: m_pendingFetches){
+    unfinished.insert(unfinished.end(), pending.waiting.begin(), pending.waiting.end());
+  }
+  for(auto&& queue: m_deferred){
+    unfinished.insert(unfinished.end(), queue.begin(), queue.end());
+  }
+  m_workerStates.clear();
+  m_pendingFetches.clear();
+  auto error = ndn::security::ValidationError(VALIDATION_OVERLOADED, "Validator destroyed");
+  for(auto& state: unfinished){
+    if(!state->certChain.empty()){
+      continue;
+    }
+    if(state->interest.has_value()){
+      state->interestFailureCb(*state->interest, error);
+    }else{
+      state->failureCb(state->data, error);
+    }
+  }
+}
+
+std::shared_ptr<Validator::Schema>
+Validator::parseSchema(const bstring_view& binary_lvs, uint64_t version, const CheckLimits& limits)
+{
+  auto schema = std::make_shared<Schema>();
+  schema->version = version;
+  schema->binary.assign(binary_lvs.begin(), binary_lvs.end());
+  auto model = lvs::LvsModel::Parse(bstring_view(schema->binary.data(), schema->binary.size()));
   if(!model.has_value()) {
     throw lvs::LvsModelError("Failed to parse LVS trust schema");
   }
-  m_checker = std::unique_ptr<lvs::Checker>(new lvs::Checker(*model, {}));
+  schema->checker = std::unique_ptr<lvs::Checker>(new lvs::Checker(*model, {}));
+  schema->checker->set_limits(limits);
+
+  auto report = schema->checker->analyze();
+  if(report.super_linear) {
+    NDN_LOG_WARN("LVS trust schema has nested ambiguous nodes; worst case check takes "
+                 << report.worst_check_steps << " steps");
+  }
+  return schema;
+}
+
+Validator::SchemaPtr
+Validator::withLimits(const SchemaPtr& schema, const CheckLimits& limits)
+{
+  auto&& current = schema->checker->get_limits();
+  if(current.max_steps == limits.max_steps && current.max_duration == limits.max_duration){
+    return schema;
+  }
+  // The copy is not shared yet, so its limits can be set
+  auto ret = std::make_shared<Schema>();
+  ret->version = schema->version;
+  ret->binary = schema->binary;
+  ret->checker = std::make_unique<Checker>(*schema->checker);
+  ret->checker->set_limits(limits);
+  ret->sharedCerts = schema->sharedCerts;
+  return ret;
+}
+
+CheckLimits
+Validator::getCheckLimits() const
+{
+  std::lock_guard<std::mutex> lock(m_checkLimitsMutex);
+  return m_checkLimits;
+}
+
+void
+Validator::setCheckLimits(const CheckLimits& limits)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_checkLimitsMutex);
+    m_checkLimits = limits;
+  }
+  installSchema(m_schema);
+}
+
+uint64_t
+Validator::reloadSchema(const bstring_view& binary_lvs)
+{
+  // Parsing happens on the calling thread, so the face thread only swaps a pointer
+  auto version = m_lastVersion.fetch_add(1) + 1;
+  SchemaPtr schema = parseSchema(binary_lvs, version, getCheckLimits());
+  postGuarded([this, schema]{ installSchema(schema); });
+  return version;
+}
+
+void
+Validator::installSchema(const SchemaPtr& schema)
+{
+  // Reloads may be posted out of order; keep the newest
+  if(schema->version < m_schema->version || (schema->version == m_schema->version && schema != m_schema)){
+    return;
+  }
+  // Limits set since schema was parsed, or since the active schema was installed, apply to it
+  auto installed = withLimits(schema, getCheckLimits());
+  if(installed == m_schema){
+    return;
+  }
+  m_schema = installed;
+  m_activeVersion.store(installed->version, std::memory_order_release);
+  m_certCache.clear();
+  m_negativeCache.clear();
+  m_resultCache.clear();
+  NDN_LOG_INFO("LVS trust schema replaced by version " << installed->version);
+}
+
+void
+Validator::addTrustAnchor(const ndn::security::Certificate& anchor)
+{
+  // The decoded key is cached by certificate name, which a replaced anchor keeps
+  m_keyCache.erase(anchor.getName());
+  if(m_anchors.erase(anchor.getName())){
+    dropVerified();
+  }
+  m_anchors.insert(anchor);
+}
+
+bool
+Validator::removeTrustAnchor(const ndn::Name& anchorName)
+{
+  if(!m_anchors.erase(anchorName)){
+    return false;
+  }
+  m_keyCache.erase(anchorName);
+  dropVerified();
+  return true;
+}
+
+void
+Validator::dropVerified()
+{
+  // Chains are not recorded, so anything verified may depend on the anchor
+  m_certCache.clear();
+  m_resultCache.clear();
+  if(m_schema->sharedCerts != nullptr){
+    m_schema->sharedCerts->clear();
+  }
+}
+
+std::optional<ndn::security::ValidationError>
+Validator::checkPolicy(const Schema& schema, const ndn::Name& pktName, const ndn::Name& keyName, bool keyPrefix,
+                       size_t explainEvents)
+{
+  try{
+    bool ok = keyPrefix ? schema.checker->check_key_prefix(pktName, keyName)
+                        : schema.checker->check(pktName, keyName);
+    if(!ok){
+      NDN_LOG_INFO("LVS check failed: " << pktName << " does not match " << keyName);
+      if(explainEvents > 0){
+        auto explanation = schema.checker->explain(pktName, keyName, explainEvents, keyPrefix).to_string();
+        NDN_LOG_DEBUG(explanation);
+        return ndn::security::ValidationError(ndn::security::ValidationError::Code::POLICY_ERROR, explanation);
+      }
+      return ndn::security::ValidationError(ndn::security::ValidationError::Code::POLICY_ERROR);
+    }
+  }catch(BudgetExceeded& e){
+    NDN_LOG_WARN("LVS check of " << pktName << " against " << keyName
+                 << " exceeded its budget after " << e.steps << " steps");
+    return ndn::security::ValidationError(ndn::security::ValidationError::Code::POLICY_ERROR, e.what());
+  }
+  return std::nullopt;
+}
+
+std::optional<ndn::security::ValidationError>
+Validator::verifySignatureAndPolicy(const ValidationState& state, const ndn::Name& certName,
+                                    const ndn::security::transform::PublicKey& key, size_t explainEvents)
+{
+  LVS_COUNT(SIGNATURE_VERIFIES, 1);
+  LVS_TIME_SCOPE(VERIFY_NANOSECONDS);
+  bool verified = state.interest.has_value() ? ndn::security::verifySignature(*state.interest, key)
+                                             : ndn::security::verifySignature(state.data, key);
+  if(!verified){
+    return ndn::security::ValidationError(ndn::security::ValidationError::Code::INVALID_SIGNATURE);
+  }
+  // Check name
+  return checkPolicy(*state.schema, state.getName(), certName, false, explainEvents);
+}
+
+void
+Validator::complete(const StatePtr& state, const std::optional<ndn::security::ValidationError>& error,
+                    const ndn::security::Certificate* cert)
+{
+  if(state->admitted){
+    state->admitted = false;
+    m_inFlight --;
+    admitDeferred();
+  }
+
+  if(state->interest.has_value()){
+    return completeInterest(state, error);
+  }
+  if(error.has_value()){
+    return state->failureCb(state->data, *error);
+  }
+  // A result under a replaced schema is not valid for later packets
+  if(cert != nullptr && m_options.resultCacheCapacity > 0 && state->schema == m_schema){
+    auto expiry = std::min(ndn::time::system_clock::now() + m_options.resultCacheLifetime,
+                           cert->getValidityPeriod().getPeriod().second);
+    m_resultCache.insert(state->data.getFullName(), expiry);
+  }
+  state->successCb(state->data);
+}
+
+void
+Validator::verifyAndCheck(const StatePtr& state, std::shared_ptr<const ndn::security::Certificate> cert)
+{
+  // The key cache is only used on the face thread; workers get the decoded key
+  auto key = m_keyCache.get(*cert);
+  if(key == nullptr){
+    return complete(state, ndn::security::ValidationError(ndn::security::ValidationError::Code::INVALID_SIGNATURE));
+  }
+
+  if(m_workers != nullptr){
+    // The job does not touch the validator, which may be destroyed while it runs
+    auto job = [this, alive = std::weak_ptr<bool>(m_alive), io = &m_face.getIoService(), state, cert, key,
+                explainEvents = m_explainEvents.load(std::memory_order_relaxed)]{
+      auto error = verifySignatureAndPolicy(*state, cert->getName(), *key, explainEvents);
+      boost::asio::post(*io, [this, alive, state, cert, error]{
+        if(alive.expired()){
+          return;
+        }
+        m_workerStates.erase(state);
+        complete(state, error, cert.get());
+      });
+    };
+    if(m_workers->submit(std::move(job))){
+      m_workerStates.insert(state);
+      return;
+    }
+    NDN_LOG_DEBUG("Worker queue is full; verifying " << state->getName() << " on the face thread");
+  }
+
+  auto error = verifySignatureAndPolicy(*state, cert->getName(), *key,
+                                        m_explainEvents.load(std::memory_order_relaxed));
+  complete(state, error, cert.get());
 }
 
 void
 Validator::validate(const ndn::Data& data,
                     const ndn::security::DataValidationSuccessCallback& successCb,
-                    const ndn::security::DataValidationFailureCallback& failureCb)
+                    const ndn::security::DataValidationFailureCallback& failureCb,
+                    ValidationPriority priority)
+{
+  LVS_COUNT(VALIDATIONS, 1);
+  // If the same packet has been validated recently
+  if(m_options.resultCacheCapacity > 0 && m_resultCache.contains(data.getFullName())){
+    return successCb(data);
+  }
+
+  auto state = std::make_shared<ValidationState>(ValidationState{data, successCb, failureCb, priority,
+                                                                 false, m_schema});
+  start(state);
+}
+
+void
+Validator::validate(const ndn::Interest& interest,
+                    const ndn::security::InterestValidationSuccessCallback& successCb,
+                    const ndn::security::InterestValidationFailureCallback& failureCb,
+                    ValidationPriority priority)
+{
+  LVS_COUNT(VALIDATIONS, 1);
+  auto state = std::make_shared<ValidationState>(ValidationState{ndn::Data(), nullptr, nullptr, priority,
+                                                                 false, m_schema});
+  state->interest = interest;
+  state->interestSuccessCb = successCb;
+  state->interestFailureCb = failureCb;
+  if(!parseSignedInterest(*state)){
+    return failureCb(interest, ndn::security::ValidationError(ndn::security::ValidationError::Code::NO_SIGNATURE));
+  }
+  // Reject a replay before any fetch or crypto. The Interest is only recorded once it is found valid.
+  if(state->interestKeyLocator.has_value() &&
+     !m_replayFilter.check(keyNameOf(state->interestKeyLocator->getName()), state->interestStamp)){
+    return failureCb(interest, ndn::security::ValidationError(ndn::security::ValidationError::Code::POLICY_ERROR,
+                                                              "Replayed or out of date signed Interest"));
+  }
+  start(state);
+}
+
+bool
+Validator::parseSignedInterest(ValidationState& state)
+{
+  const auto& interest = *state.interest;
+  const auto& name = interest.getName();
+  try{
+    auto info = interest.getSignatureInfo();
+    if(info.has_value()){
+      // The name ends with the digest of the parameters, which cover the signature
+      state.interestName = name;
+      if(!name.empty() && name[-1].isParametersSha256Digest()){
+        state.interestName = name.getPrefix(-1);
+      }
+      state.interestStamp = ReplayFilter::Stamp{info->getTime(), info->getSeqNum(), info->getNonce()};
+    }else{
+      // Command Interest: /<name>/<timestamp>/<random value>/<SignatureInfo>/<SignatureValue>
+      if(name.size() < 4){
+        return false;
+      }
+      info = ndn::SignatureInfo(name[-2].blockFromValue());
+      state.interestName = name.getPrefix(-4);
+      state.interestStamp.time = ndn::time::fromUnixTimestamp(ndn::time::milliseconds(name[-4].toNumber()));
+      state.interestStamp.nonce = std::vector<uint8_t>(name[-3].value(), name[-3].value() + name[-3].value_size());
+    }
+    if(info->hasKeyLocator()){
+      state.interestKeyLocator = info->getKeyLocator();
+    }
+  }catch(ndn::tlv::Error&){
+    return false;
+  }
+  return true;
+}
+
+void
+Validator::completeInterest(const StatePtr& state, std::optional<ndn::security::ValidationError> error)
 {
-  auto keyLocator = data.getKeyLocator();
+  // Of two copies of an Interest validated at the same time, the one finishing last fails here
+  if(!error.has_value() &&
+     !m_replayFilter.insert(keyNameOf(state->interestKeyLocator->getName()), state->interestStamp)){
+    error = ndn::security::ValidationError(ndn::security::ValidationError::Code::POLICY_ERROR,
+                                           "Replayed or out of date signed Interest");
+  }
+  if(error.has_value()){
+    return state->interestFailureCb(*state->interest, *error);
+  }
+  state->interestSuccessCb(*state->interest);
+}
+
+void
+Validator::start(const StatePtr& state)
+{
+  if(m_options.maxInFlightValidations > 0 && m_inFlight >= m_options.maxInFlightValidations){
+    return defer(state);
+  }
+  state->admitted = true;
+  m_inFlight ++;
+  process(state);
+}
+
+void
+Validator::defer(const StatePtr& state)
+{
+  if(m_deferredCount >= m_options.maxDeferredValidations){
+    // Displace the latest validation of the lowest priority below this one, if any
+    StatePtr displaced = state;
+    for(size_t level = m_deferred.size() - 1; level > size_t(state->priority); level --){
+      if(!m_deferred[level].empty()){
+        displaced = m_deferred[level].back();
+        m_deferred[level].pop_back();
+        m_deferredCount --;
+        break;
+      }
+    }
+    NDN_LOG_DEBUG("Validator overloaded; refusing " << displaced->getName());
+    if(displaced == state){
+      return complete(state, ndn::security::ValidationError(VALIDATION_OVERLOADED, "Too many validations"));
+    }
+    complete(displaced, ndn::security::ValidationError(VALIDATION_OVERLOADED, "Too many validations"));
+  }
+  m_deferred[size_t(state->priority)].push_back(state);
+  m_deferredCount ++;
+}
+
+void
+Validator::admitDeferred()
+{
+  // Admitted validations may finish at once and call back here; the outermost call does the work
+  if(m_admitting){
+    return;
+  }
+  m_admitting = true;
+  while(m_deferredCount > 0 &&
+        (m_options.maxInFlightValidations == 0 || m_inFlight < m_options.maxInFlightValidations)){
+    StatePtr state;
+    for(auto& queue: m_deferred){
+      if(!queue.empty()){
+        state = queue.front();
+        queue.pop_front();
+        break;
+      }
+    }
+    m_deferredCount --;
+    state->admitted = true;
+    m_inFlight ++;
+    process(state);
+  }
+  m_admitting = false;
+}
+
+void
+Validator::process(const StatePtr& state)
+{
+  auto keyLocator = state->getKeyLocator();
   if(!keyLocator.has_value()){
-    return failureCb(data, ndn::security::ValidationError::Code::NO_SIGNATURE);
+    return complete(state, ndn::security::ValidationError(ndn::security::ValidationError::Code::NO_SIGNATURE));
+  }
+
+  // Reject names the schema does not allow the key locator to sign before any fetch or crypto.
+  // The key locator may be a key name, so the exact check waits until the certificate is known.
+  if(auto error = checkPolicy(*state->schema, state->getName(), keyLocator->getName(), true,
+                               m_explainEvents.load(std::memory_order_relaxed))){
+    return complete(state, error);
   }
 
   // If trust anchor
-  if(keyLocator->getName().isPrefixOf(m_anchor.getName())){
-    if(!ndn::security::verifySignature(data, m_anchor)){
-      return failureCb(data, ndn::security::ValidationError::Code::INVALID_SIGNATURE);
+  if(auto anchor = m_anchors.find(keyLocator->getName())){
+    return verifyAndCheck(state, anchor);
+  }
+
+  // If the chain of the signing certificate has been verified before
+  if(auto cert = m_certCache.find(keyLocator->getName())){
+    return verifyAndCheck(state, cert);
+  }
+  if(state->schema->sharedCerts != nullptr){
+    if(auto cert = state->schema->sharedCerts->find(keyLocator->getName())){
+      return verifyAndCheck(state, cert);
     }
-    // Check name
-    if(!m_checker->check(data.getName(), m_anchor.getName())){
-      NDN_LOG_INFO("LVS check failed: " << data.getName() << " does not match " << m_anchor.getName());
-      return failureCb(data, ndn::security::ValidationError::Code::POLICY_ERROR);
+  }
+
+  // If the certificate failed recently
+  if(auto error = m_negativeCache.find(keyLocator->getName())){
+    return complete(state, error);
+  }
+
+  // A certificate whose chain comes back to itself would wait on its own fetch forever
+  if(auto error = checkChain(*state, keyLocator->getName())){
+    return complete(state, error);
+  }
+
+  // Join the fetch in flight for the same key under the same schema, if any
+  if(m_pendingFetches.count({state->schema.get(), keyLocator->getName()}) > 0){
+    return addPending(keyLocator->getName(), state);
+  }
+  // If a certificate stored by an earlier run is not verified yet, verify it now instead of fetching it
+  auto stored = m_storedCerts.lower_bound(keyLocator->getName());
+  if(stored != m_storedCerts.end() && keyLocator->getName().isPrefixOf(stored->first)){
+    auto certData = std::move(stored->second);
+    m_storedCerts.erase(stored);
+    addPending(keyLocator->getName(), state);
+    return validateCertificate(state->schema, keyLocator->getName(), certData);
+  }
+  if(m_options.maxPendingFetches > 0 && m_pendingFetches.size() >= m_options.maxPendingFetches){
+    NDN_LOG_DEBUG("Too many certificate fetches; refusing " << state->getName());
+    return complete(state, ndn::security::ValidationError(VALIDATION_OVERLOADED, "Too many certificate fetches"));
+  }
+  addPending(keyLocator->getName(), state);
+  fetchCertificate(state->schema, keyLocator->getName());
+}
+
+std::optional<ndn::security::ValidationError>
+Validator::checkChain(const ValidationState& state, const ndn::Name& keyLocator) const
+{
+  // A packet only starts a chain
+  if(state.certChain.empty()){
+    return std::nullopt;
+  }
+  if(m_options.maxChainDepth > 0 && state.certChain.size() >= m_options.maxChainDepth){
+    return ndn::security::ValidationError(ndn::security::ValidationError::Code::EXCEEDED_DEPTH_LIMIT,
+                                          keyLocator.toUri());
+  }
+  // Follow the certificates that keyLocator waits on, which may have been fetched for another packet
+  std::optional<ndn::Name> next = keyLocator;
+  while(next.has_value()){
+    if(std::find(state.certChain.begin(), state.certChain.end(), *next) != state.certChain.end()){
+      return ndn::security::ValidationError(ndn::security::ValidationError::Code::LOOP_DETECTED, next->toUri());
     }
-    return successCb(data);
-  } else {
-    // Fetch certificate
-    ndn::Interest interest(keyLocator->getName());
-    interest.setMustBeFresh(true);
-    interest.setCanBePrefix(true);
-
-    m_face.expressInterest(interest,
-      [failureCb, successCb, data, this](const ndn::Interest&, const ndn::Data& certData){
-        validate(certData,
-        [=](const ndn::Data& certDataVerified){
-          ndn::security::Certificate cert;
-          try{
-            cert = ndn::security::Certificate(certDataVerified);
-          }catch(ndn::tlv::Error&){
-            return failureCb(data, ndn::security::ValidationError::Code::MALFORMED_CERT);
-          }
-          if(!ndn::security::verifySignature(data, cert)){
-            return failureCb(data, ndn::security::ValidationError::Code::INVALID_SIGNATURE);
-          }
-          // Check name
-          if(!m_checker->check(data.getName(), cert.getName())){
-            NDN_LOG_INFO("LVS check failed: " << data.getName() << " does not match " << cert.getName());
-            return failureCb(data, ndn::security::ValidationError::Code::POLICY_ERROR);
-          }
-          return successCb(data);
-        },
-        [failureCb, data](const ndn::Data&, ndn::security::ValidationError){
-          failureCb(data, ndn::security::ValidationError::Code::MALFORMED_CERT);
-        });
-      },
-      [failureCb, data](const ndn::Interest&, const ndn::lp::Nack& nack){
-        failureCb(data, ndn::security::ValidationError::Code::CANNOT_RETRIEVE_CERT);
-      },
-      [failureCb, data](const ndn::Interest&){
-        failureCb(data, ndn::security::ValidationError::Code::CANNOT_RETRIEVE_CERT);
+    auto pending = m_pendingFetches.find({state.schema.get(), *next});
+    next = pending != m_pendingFetches.end() ? pending->second.waitingOn : std::nullopt;
+  }
+  return std::nullopt;
+}
+
+void
+Validator::addPending(const ndn::Name& keyLocator, const StatePtr& state)
+{
+  auto& pending = m_pendingFetches[{state->schema.get(), keyLocator}];
+  if(pending.schema == nullptr){
+    pending.schema = state->schema;
+  }
+  if(pending.chain.empty()){
+    pending.chain = state->certChain;
+    pending.chain.push_back(keyLocator);
+  }
+  pending.waiting.push_back(state);
+  if(!state->certChain.empty()){
+    auto waiter = m_pendingFetches.find({state->schema.get(), state->certChain.back()});
+    if(waiter != m_pendingFetches.end()){
+      waiter->second.waitingOn = keyLocator;
+    }
+  }
+}
+
+size_t
+Validator::prefetch(const ndn::Name& name)
+{
+  size_t started = 0;
+  for(auto&& tmpl: m_schema->checker->suggest_keys(name, true)){
+    // Only the fixed part of the key name can be fetched; with none, the signer is unpredictable
+    auto keyPrefix = tmpl.prefix();
+    if(keyPrefix.empty() || m_anchors.find(keyPrefix) != nullptr){
+      continue;
+    }
+    if(m_pendingFetches.count({m_schema.get(), keyPrefix}) > 0 || m_certCache.find(keyPrefix) != nullptr ||
+       m_negativeCache.find(keyPrefix).has_value()){
+      continue;
+    }
+    if(m_options.maxPendingFetches > 0 && m_pendingFetches.size() >= m_options.maxPendingFetches){
+      break;
+    }
+    NDN_LOG_DEBUG("Prefetching certificate " << keyPrefix << " for " << name);
+    m_pendingFetches[{m_schema.get(), keyPrefix}].schema = m_schema;
+    fetchCertificate(m_schema, keyPrefix);
+    started ++;
+  }
+  return started;
+}
+
+void
+Validator::fetchCertificate(const SchemaPtr& schema, const ndn::Name& keyLocator)
+{
+  ndn::Interest interest(keyLocator);
+  interest.setMustBeFresh(true);
+  interest.setCanBePrefix(true);
+
+  LVS_COUNT(CERT_FETCHES, 1);
+  LVS_PROBE2(fetch_start, keyLocator.wireEncode().data(), keyLocator.wireEncode().size());
+  // The face may answer after the validator is gone
+  m_face.expressInterest(interest,
+    [schema, keyLocator, this, alive = std::weak_ptr<bool>(m_alive)](const ndn::Interest&, const ndn::Data& certData){
+      LVS_PROBE2(fetch_end, keyLocator.wireEncode().data(), 0);
+      if(!alive.expired()){
+        validateCertificate(schema, keyLocator, certData);
+      }
+    },
+    [schema, keyLocator, this, alive = std::weak_ptr<bool>(m_alive)](const ndn::Interest&, const ndn::lp::Nack& nack){
+      LVS_PROBE2(fetch_end, keyLocator.wireEncode().data(), 1);
+      if(!alive.expired()){
+        failPending(schema, keyLocator, ndn::security::ValidationError::Code::CANNOT_RETRIEVE_CERT,
+                    m_options.retrievalFailureTtl);
+      }
+    },
+    [schema, keyLocator, this, alive = std::weak_ptr<bool>(m_alive)](const ndn::Interest&){
+      LVS_PROBE2(fetch_end, keyLocator.wireEncode().data(), 2);
+      if(!alive.expired()){
+        failPending(schema, keyLocator, ndn::security::ValidationError::Code::CANNOT_RETRIEVE_CERT,
+                    m_options.retrievalFailureTtl);
+      }
+    }
+  );
+}
+
+void
+Validator::validateCertificate(const SchemaPtr& schema, const ndn::Name& keyLocator, const ndn::Data& certData)
+{
+  auto onCertValid = [keyLocator, schema, this](const ndn::Data& certDataVerified){
+    std::shared_ptr<const ndn::security::Certificate> cert;
+    try{
+      cert = std::make_shared<const ndn::security::Certificate>(certDataVerified);
+    }catch(ndn::tlv::Error& e){
+      return failPending(schema, keyLocator,
+                         ndn::security::ValidationError(ndn::security::ValidationError::Code::MALFORMED_CERT,
+                                                        e.what()),
+                         m_options.malformedCertTtl);
+    }
+    // A certificate accepted under a replaced schema still serves the validations waiting on it,
+    // which all started under that schema, but is not kept for later ones
+    if(schema == m_schema){
+      m_certCache.insert(*cert);
+    }
+    if(schema->sharedCerts != nullptr){
+      schema->sharedCerts->insert(*cert);
+    }
+    if(m_certStore != nullptr && schema == m_schema){
+      try{
+        m_certStore->insert(*cert);
+      }catch(CertStore::Error& e){
+        NDN_LOG_WARN(e.what());
       }
-    );
+    }
+    for(auto& pending: takePending(schema, keyLocator)){
+      verifyAndCheck(pending, cert);
+    }
+  };
+  auto onCertInvalid = [keyLocator, schema, this](const ndn::Data& certData,
+                                                 const ndn::security::ValidationError& certError){
+    // Nothing was learned about the certificate under the active schema, so nothing is remembered.
+    // The depth of a chain also depends on the packet that needed the certificate.
+    if(certError.getCode() == VALIDATION_OVERLOADED ||
+       certError.getCode() == ndn::security::ValidationError::Code::EXCEEDED_DEPTH_LIMIT ||
+       schema != m_schema){
+      return failPending(schema, keyLocator, certError, ndn::time::nanoseconds::zero());
+    }
+    if(m_certStore != nullptr){
+      try{
+        m_certStore->erase(certData.getName());
+      }catch(CertStore::Error& e){
+        NDN_LOG_WARN(e.what());
+      }
+    }
+    // A certificate whose own signer cannot be retrieved may become valid sooner than a bad one
+    auto ttl = m_options.malformedCertTtl;
+    if(certError.getCode() == ndn::security::ValidationError::Code::CANNOT_RETRIEVE_CERT){
+      ttl = m_options.retrievalFailureTtl;
+    }else if(certError.getCode() == ndn::security::ValidationError::Code::POLICY_ERROR){
+      ttl = m_options.certPolicyErrorTtl;
+    }
+    if(certError.getCode() == ndn::security::ValidationError::Code::LOOP_DETECTED){
+      return failPending(schema, keyLocator, certError, m_options.malformedCertTtl);
+    }
+    failPending(schema, keyLocator,
+                ndn::security::ValidationError(ndn::security::ValidationError::Code::MALFORMED_CERT,
+                                               certData.getName().toUri()),
+                ttl);
+  };
+
+  // The certificate chain is validated as part of the validations waiting on it,
+  // so it is not subject to admission again
+  auto state = std::make_shared<ValidationState>(ValidationState{certData, onCertValid, onCertInvalid,
+                                                                 ValidationPriority::HIGH, false, schema});
+  auto pending = m_pendingFetches.find({schema.get(), keyLocator});
+  if(pending != m_pendingFetches.end()){
+    state->certChain = pending->second.chain;
+  }
+  if(state->certChain.empty()){
+    state->certChain.push_back(keyLocator);
+  }
+  process(state);
+}
+
+void
+Validator::revalidateStored()
+{
+  if(m_storedCerts.empty()){
+    return;
+  }
+  auto stored = m_storedCerts.begin();
+  auto certName = stored->first;
+  auto certData = std::move(stored->second);
+  m_storedCerts.erase(stored);
+  if(m_pendingFetches.count({m_schema.get(), certName}) == 0 && m_certCache.find(certName) == nullptr){
+    m_pendingFetches[{m_schema.get(), certName}].schema = m_schema;
+    validateCertificate(m_schema, certName, certData);
+  }
+  // One certificate per turn of the event loop, so that validations of new packets are not held up
+  postGuarded([this]{ revalidateStored(); });
+}
+
+std::vector<Validator::StatePtr>
+Validator::takePending(const SchemaPtr& schema, const ndn::Name& keyLocator)
+{
+  // Callbacks may start new validations, so the entry is removed before any of them runs
+  std::vector<StatePtr> ret;
+  auto it = m_pendingFetches.find({schema.get(), keyLocator});
+  if(it != m_pendingFetches.end()){
+    ret = std::move(it->second.waiting);
+    m_pendingFetches.erase(it);
+  }
+  // The certificates that waited on keyLocator no longer do
+  for(auto& state: ret){
+    if(state->certChain.empty()){
+      continue;
+    }
+    auto waiter = m_pendingFetches.find({schema.get(), state->certChain.back()});
+    if(waiter != m_pendingFetches.end() && waiter->second.waitingOn == keyLocator){
+      waiter->second.waitingOn = std::nullopt;
+    }
+  }
+  return ret;
+}
+
+void
+Validator::failPending(const SchemaPtr& schema, const ndn::Name& keyLocator,
+                       const ndn::security::ValidationError& error, ndn::time::nanoseconds ttl)
+{
+  m_negativeCache.insert(keyLocator, error, ttl);
+  for(auto& pending: takePending(schema, keyLocator)){
+    complete(pending, error);
   }
 }
 
-} // namespace lvs
\ No newline at end of file
+} // namespace lvs
@@ -1,31 +1,424 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <deque>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
 #include "ndn-cxx/face.hpp"
 #include "ndn-cxx/security/certificate-storage.hpp"
 #include "ndn-cxx/security/validation-callback.hpp"
+#include "lvs-cert-cache.hpp"
+#include "lvs-cert-store.hpp"
 #include "lvs-checker.hpp"
+#include "lvs-replay-filter.hpp"
+#include "lvs-thread-pool.hpp"
+#include "lvs-trust-anchors.hpp"
 
 namespace lvs {
 
+// Order in which deferred validations are admitted when the validator is busy
+enum class ValidationPriority {
+  HIGH = 0,
+  NORMAL = 1,
+  LOW = 2,
+};
+
+// Error code of validations refused because the validator is at its limits.
+// The packet was not judged and may be validated again later.
+constexpr uint32_t VALIDATION_OVERLOADED = ndn::security::ValidationError::Code::USER_MIN;
+
+struct ValidatorOptions {
+  // Maximum number of verified certificates kept. 0 disables the cache.
+  size_t certCacheCapacity = 1024;
+  // A cached certificate is re-verified after this long even if still valid.
+  ndn::time::nanoseconds certCacheLifetime = ndn::time::hours(1);
+  // Maximum number of decoded public keys kept. 0 decodes the key for every verification.
+  size_t publicKeyCacheCapacity = 1024;
+  // Maximum number of key locators whose certificate failed to be retrieved or validated. 0 disables it.
+  size_t negativeCacheCapacity = 1024;
+  // How long each kind of failure is remembered. 0 disables caching that kind.
+  ndn::time::nanoseconds retrievalFailureTtl = ndn::time::seconds(10);
+  ndn::time::nanoseconds malformedCertTtl = ndn::time::minutes(5);
+  ndn::time::nanoseconds certPolicyErrorTtl = ndn::time::minutes(5);
+  // Maximum number of Data packets, by full name, remembered as valid. 0 disables the cache.
+  size_t resultCacheCapacity = 0;
+  // How long a packet is remembered as valid, at most until its signing certificate expires.
+  ndn::time::nanoseconds resultCacheLifetime = ndn::time::seconds(10);
+  // Threads that verify signatures and run LVS checks. Results are posted back to the io context
+  // of the face, so callbacks still run on the face thread. 0 does the work on the face thread.
+  size_t workerThreads = 0;
+  // Maximum number of jobs waiting for a worker. When the queue is full, the job runs on the face thread.
+  size_t workerQueueDepth = 1024;
+  // SQLite database where verified certificates are kept across restarts. Empty for none.
+  // Stored certificates have their chains verified again, in the background or when first needed.
+  std::string certStorePath;
+  // Maximum number of validations in progress. Further ones are deferred. 0 for no limit.
+  size_t maxInFlightValidations = 0;
+  // Maximum number of deferred validations. When full, a new validation displaces the latest deferred one
+  // of a lower priority, or fails with VALIDATION_OVERLOADED if there is none.
+  size_t maxDeferredValidations = 1024;
+  // Maximum number of certificate Interests outstanding. A validation that needs another fetch
+  // fails with VALIDATION_OVERLOADED. 0 for no limit.
+  size_t maxPendingFetches = 0;
+  // Maximum number of certificates fetched or loaded to validate one packet, not counting the trust anchor.
+  // A longer chain fails with EXCEEDED_DEPTH_LIMIT. 0 for no limit.
+  size_t maxChainDepth = 25;
+  // Signed Interests whose timestamp is further than this from now fail. 0 disables the check.
+  ndn::time::nanoseconds interestGracePeriod = ndn::time::minutes(2);
+  // Signing keys whose latest signed Interest is remembered to reject replays, and nonces kept per key.
+  // A signed Interest with none of timestamp, sequence number and nonce always fails.
+  size_t interestReplayKeys = 1000;
+  size_t interestReplayNonces = 16;
+  // A failed LVS check is run again to explain it, recording up to this many search steps in the
+  // info of the POLICY_ERROR. Passing checks are not run again. 0 disables it.
+  size_t explainEvents = 0;
+};
+
 class Validator: public ndn::security::CertificateStorage {
 public:
   Validator(const tlv::bstring_view& binary_lvs,
             ndn::Face& face,
-            const ndn::security::Certificate& trust_anchor);
+            const ndn::security::Certificate& trust_anchor,
+            const ValidatorOptions& options = {});
+
+  Validator(const tlv::bstring_view& binary_lvs,
+            ndn::Face& face,
+            const std::vector<ndn::security::Certificate>& trust_anchors,
+            const ValidatorOptions& options = {});
+
+  // Validations not finished yet fail with VALIDATION_OVERLOADED, from the destructor.
+  // Their callbacks must not use the validator.
+  ~Validator();
+
+  // Trust a new anchor, or replace the anchor with the same name. The schema is unchanged.
+  // Cached certificates and results are dropped when an anchor is replaced, as its key may differ.
+  void
+  addTrustAnchor(const ndn::security::Certificate& anchor);
+
+  // Stop trusting an anchor. Cached certificates and results, which may chain to it, are dropped.
+  // Returns whether the anchor was found.
+  bool
+  removeTrustAnchor(const ndn::Name& anchorName);
 
-  ~Validator() = default;
+  const TrustAnchorSet&
+  getTrustAnchors() const
+  {
+    return m_anchors;
+  }
 
   void
   validate(const ndn::Data& data,
            const ndn::security::DataValidationSuccessCallback& successCb,
-           const ndn::security::DataValidationFailureCallback& failureCb);
+           const ndn::security::DataValidationFailureCallback& failureCb,
+           ValidationPriority priority = ValidationPriority::NORMAL);
+
+  // Validate a signed Interest, either with InterestSignatureInfo or in the command Interest layout
+  // with the signature in the last four name components. The name without its signature components
+  // is checked against the schema. Interests replayed, or with a timestamp outside the grace period, fail.
+  void
+  validate(const ndn::Interest& interest,
+           const ndn::security::InterestValidationSuccessCallback& successCb,
+           const ndn::security::InterestValidationFailureCallback& failureCb,
+           ValidationPriority priority = ValidationPriority::NORMAL);
+
+  // Fetch and verify ahead of time the certificates of the keys the schema allows to sign
+  // packets under name, so that the first such packet does not wait on its certificate chain.
+  // name may be a prefix of the packets to come; captures in it narrow the predicted keys.
+  // Returns the number of certificate fetches started.
+  size_t
+  prefetch(const ndn::Name& name);
+
+  // Validations admitted and not yet finished
+  size_t
+  getInFlightCount() const
+  {
+    return m_inFlight;
+  }
+
+  // Validations waiting for admission
+  size_t
+  getDeferredCount() const
+  {
+    return m_deferredCount;
+  }
+
+  // Bound the work of each LVS check. A check over the budget fails validation with POLICY_ERROR.
+  // The limits belong to the schema: a copy of the active one with the new limits is swapped in,
+  // and cached certificates and results are dropped as on a reload. Validations in progress keep
+  // the limits they started with. Call it on the face thread; later reloads get the same limits.
+  void
+  setCheckLimits(const CheckLimits& limits);
+
+  // Explain the next failed LVS checks with up to maxEvents search steps, or stop with 0;
+  // see ValidatorOptions::explainEvents. May be called from any thread, e.g. to sample traffic.
+  void
+  setExplainEvents(size_t maxEvents)
+  {
+    m_explainEvents.store(maxEvents, std::memory_order_relaxed);
+  }
+
+  // The checker of the active schema, valid until the schema or its limits are replaced.
+  const Checker&
+  getChecker() const
+  {
+    return *m_schema->checker;
+  }
+
+  // Replace the trust schema; may be called from any thread.
+  // The new schema is parsed by the caller, then swapped in on the face thread. Validations in
+  // progress finish with the schema they started with, and later ones use the new schema.
+  // Cached certificates and results, which were accepted under the old schema, are dropped.
+  // Throws LvsModelError if binary_lvs cannot be parsed. Returns the version of the new schema.
+  uint64_t
+  reloadSchema(const tlv::bstring_view& binary_lvs);
+
+  // Version of the active schema: 1 for the schema given to the constructor, incremented by each reload.
+  uint64_t
+  getSchemaVersion() const
+  {
+    return m_activeVersion.load(std::memory_order_acquire);
+  }
+
+  // Certificates whose chain has been verified, with hit and miss statistics.
+  const CertCache&
+  getCertCache() const
+  {
+    return m_certCache;
+  }
+
+  // Decoded public keys of certificates, with hit and miss statistics.
+  const PublicKeyCache&
+  getPublicKeyCache() const
+  {
+    return m_keyCache;
+  }
+
+  // Full names of Data recently validated, with hit and miss statistics.
+  const ValidationResultCache&
+  getResultCache() const
+  {
+    return m_resultCache;
+  }
+
+  // Key locators known to be bad, with hit and miss statistics.
+  const NegativeCertCache&
+  getNegativeCache() const
+  {
+    return m_negativeCache;
+  }
 
 private:
-  std::vector<uint8_t> m_binary_lvs;
-  std::unique_ptr<Checker> m_checker;
+  // One version of the trust schema. Validations hold the version they started with,
+  // so it lives until the last of them finishes.
+  struct Schema {
+    uint64_t version;
+    std::vector<uint8_t> binary;
+    std::unique_ptr<Checker> checker;
+    // Certificates verified under this version by any shard of a ShardedValidator, or null
+    std::shared_ptr<ConcurrentCertCache> sharedCerts;
+  };
+
+  using SchemaPtr = std::shared_ptr<const Schema>;
+
+  // Everything a validation needs until it finishes, shared by each step instead of copied
+  struct ValidationState {
+    ndn::Data data;
+    ndn::security::DataValidationSuccessCallback successCb;
+    ndn::security::DataValidationFailureCallback failureCb;
+    ValidationPriority priority;
+    bool admitted = false;  // Counted in m_inFlight
+    SchemaPtr schema;
+
+    // Set for a signed Interest, in which case data and its callbacks are unused
+    std::optional<ndn::Interest> interest = std::nullopt;
+    ndn::security::InterestValidationSuccessCallback interestSuccessCb = nullptr;
+    ndn::security::InterestValidationFailureCallback interestFailureCb = nullptr;
+    ndn::Name interestName = {};  // Without the signature components
+    std::optional<ndn::KeyLocator> interestKeyLocator = std::nullopt;
+    ReplayFilter::Stamp interestStamp = {};
+
+    // Set for a certificate: the key locators of the certificates being validated for the packet,
+    // from the one the packet needs down to the one of this state
+    std::vector<ndn::Name> certChain = {};
+
+    // The name checked against the schema
+    const ndn::Name&
+    getName() const
+    {
+      return interest.has_value() ? interestName : data.getName();
+    }
+
+    std::optional<ndn::KeyLocator>
+    getKeyLocator() const
+    {
+      return interest.has_value() ? interestKeyLocator : data.getKeyLocator();
+    }
+  };
+
+  static std::shared_ptr<Schema>
+  parseSchema(const tlv::bstring_view& binary_lvs, uint64_t version, const CheckLimits& limits);
+
+  // schema if its checker has limits, or else a copy of it whose checker does
+  static SchemaPtr
+  withLimits(const SchemaPtr& schema, const CheckLimits& limits);
+
+  CheckLimits
+  getCheckLimits() const;
+
+  // Make schema the active one, with the current check limits, and drop what was cached under
+  // the old one. Runs on the face thread.
+  void
+  installSchema(const SchemaPtr& schema);
+
+  // Used by ShardedValidator, whose shards share one schema
+  Validator(SchemaPtr schema,
+            ndn::Face& face,
+            const std::vector<ndn::security::Certificate>& trust_anchors,
+            const ValidatorOptions& options);
+
+  friend class ShardedValidator;
+
+  // Post fn to the io context of the face, to run unless the validator is destroyed first.
+  template<typename Fn>
+  void
+  postGuarded(Fn&& fn);
+
+  using StatePtr = std::shared_ptr<ValidationState>;
+
+  // Fill in the name, key locator and stamp of a signed Interest. Returns false if it is not signed.
+  static bool
+  parseSignedInterest(ValidationState& state);
+
+  // Admit a validation, or defer it if too many are in progress.
+  void
+  start(const StatePtr& state);
+
+  // Run the validation pipeline: policy pre-check, anchor, caches, then certificate fetch.
+  void
+  process(const StatePtr& state);
+
+  // Finish a validation with error, or with success if none, and admit deferred validations.
+  void
+  complete(const StatePtr& state, const std::optional<ndn::security::ValidationError>& error,
+           const ndn::security::Certificate* cert = nullptr);
+
+  // Record a valid signed Interest against replay, then call back.
+  void
+  completeInterest(const StatePtr& state, std::optional<ndn::security::ValidationError> error);
+
+  // Queue a validation that cannot be admitted now, displacing one of lower priority if full.
+  void
+  defer(const StatePtr& state);
+
+  void
+  admitDeferred();
+
+  // Fetch and validate under schema the certificate named by keyLocator, then serve every validation
+  // of that schema waiting on it.
+  void
+  fetchCertificate(const SchemaPtr& schema, const ndn::Name& keyLocator);
+
+  // Validate under schema the chain of certData, fetched for keyLocator, then serve the validations
+  // of that schema waiting on it.
+  void
+  validateCertificate(const SchemaPtr& schema, const ndn::Name& keyLocator, const ndn::Data& certData);
+
+  // The error of a certificate of state that needs the certificate of keyLocator, if that makes
+  // the chain too long or closes a loop, which would leave the fetch waiting on itself.
+  std::optional<ndn::security::ValidationError>
+  checkChain(const ValidationState& state, const ndn::Name& keyLocator) const;
+
+  // Add state to the validations of its schema waiting on the certificate of keyLocator,
+  // creating the entry if needed.
+  void
+  addPending(const ndn::Name& keyLocator, const StatePtr& state);
+
+  // Verify the chain of the next certificate loaded from the store.
+  void
+  revalidateStored();
+
+  // Drop the certificates and results verified so far, which may chain to a replaced or removed anchor.
+  void
+  dropVerified();
+
+  // Remove the validations of schema waiting on keyLocator from the pending-fetch table.
+  std::vector<StatePtr>
+  takePending(const SchemaPtr& schema, const ndn::Name& keyLocator);
+
+  // Remember the failure of keyLocator for the TTL of its kind, then fail every validation of schema
+  // waiting on it.
+  void
+  failPending(const SchemaPtr& schema, const ndn::Name& keyLocator, const ndn::security::ValidationError& error,
+              ndn::time::nanoseconds ttl);
+
+  // Verify the signature of data with a verified certificate and run the LVS check,
+  // on a worker thread if there are any, then complete on the face thread.
+  void
+  verifyAndCheck(const StatePtr& state, std::shared_ptr<const ndn::security::Certificate> cert);
+
+  // The error of the packet of state signed by the certificate certName with key, if any.
+  // Safe to call from worker threads.
+  static std::optional<ndn::security::ValidationError>
+  verifySignatureAndPolicy(const ValidationState& state, const ndn::Name& certName,
+                           const ndn::security::transform::PublicKey& key, size_t explainEvents);
+
+  // Run the LVS check of pktName against keyName, returning the error if it fails.
+  // If keyPrefix is set, keyName only needs to be a prefix of a key allowed to sign pktName.
+  // If explainEvents is not 0, the error info holds an explanation of the failed check.
+  static std::optional<ndn::security::ValidationError>
+  checkPolicy(const Schema& schema, const ndn::Name& pktName, const ndn::Name& keyName, bool keyPrefix,
+              size_t explainEvents);
+
+private:
+  // Only read and replaced on the face thread; workers use the version held by each validation
+  SchemaPtr m_schema;
+  std::atomic<uint64_t> m_activeVersion{0};
+  std::atomic<uint64_t> m_lastVersion{0};
+  // Written on the face thread and read by reloadSchema() on any thread
+  mutable std::mutex m_checkLimitsMutex;
+  CheckLimits m_checkLimits;
+  std::atomic<size_t> m_explainEvents{0};
   ndn::Face& m_face;
-  ndn::security::Certificate m_anchor;
+  TrustAnchorSet m_anchors;
+  ValidatorOptions m_options;
+  CertCache m_certCache;
+  PublicKeyCache m_keyCache;
+  NegativeCertCache m_negativeCache;
+  ValidationResultCache m_resultCache;
+  ReplayFilter m_replayFilter;
+  // A certificate being fetched and validated, and the validations waiting on it
+  struct PendingFetch {
+    // The schema the certificate is validated under, which is that of every validation waiting on it
+    SchemaPtr schema;
+    std::vector<StatePtr> waiting;
+    // Key locators of the certificates that led to this one, ending with its own; see ValidationState::certChain
+    std::vector<ndn::Name> chain;
+    // The key locator of the certificate its own validation waits on, if any
+    std::optional<ndn::Name> waitingOn;
+  };
+
+  // Certificates being fetched and validated, keyed by schema and key locator name. A validation only
+  // joins a fetch of its own schema, so a chain checked under a replaced schema serves no later one.
+  using PendingKey = std::pair<const Schema*, ndn::Name>;
+  std::map<PendingKey, PendingFetch> m_pendingFetches;
+  size_t m_inFlight = 0;
+  // Deferred validations by priority, oldest first
+  std::array<std::deque<StatePtr>, 3> m_deferred;
+  size_t m_deferredCount = 0;
+  bool m_admitting = false;
+  std::unique_ptr<CertStore> m_certStore;
+  // Certificates loaded from the store whose chains have not been verified again yet
+  std::map<ndn::Name, ndn::Data> m_storedCerts;
+  // Validations whose signature is verified by a worker, until their completion runs on the face thread
+  std::set<StatePtr> m_workerStates;
+  // Handlers posted to the face and fetch callbacks hold it weakly, and do nothing once it is gone
+  std::shared_ptr<bool> m_alive = std::make_shared<bool>(true);
+  // Destroyed first, so running jobs finish while the rest of the validator is alive
+  std::unique_ptr<ThreadPool> m_workers;
 };
 
 } // namespace lvs
@@ -41,14 +41,14 @@ concept ByteString =
 template<typename T, typename B>
 concept Parsable =
   requires(T e, const B& wire) {
-    ByteString<B>;
+    requires ByteString<B>;
     T::Parse(wire);
   };
 
 template<typename T, typename E, typename B>
 concept Parses =
   requires(T value, const B& wire) {
-    Parsable<E, B>;
+    requires Parsable<E, B>;
     { E::Parse(wire) } -> std::convertible_to<ParseResult<T>>;
   };
 
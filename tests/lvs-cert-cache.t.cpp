@@ -0,0 +1,165 @@
+#include <boost-test.hpp>
+
+#include "lvs-cert-cache.hpp"
+#include <atomic>
+#include <thread>
+
+namespace tests {
+
+using lvs::CertCache;
+using namespace ndn::time_literals;
+
+static ndn::security::Certificate
+MakeCert(const std::string& name,
+         ndn::time::system_clock::time_point notBefore,
+         ndn::time::system_clock::time_point notAfter)
+{
+  ndn::security::Certificate cert;
+  cert.setName(ndn::Name(name));
+  ndn::SignatureInfo info(ndn::tlv::SignatureSha256WithEcdsa, ndn::KeyLocator(ndn::Name("/anchor/KEY/1")));
+  info.setValidityPeriod(ndn::security::ValidityPeriod(notBefore, notAfter));
+  cert.setSignatureInfo(info);
+  return cert;
+}
+
+BOOST_AUTO_TEST_SUITE(TestCertCache)
+
+BOOST_AUTO_TEST_CASE(FindByKeyLocator) {
+  auto now = ndn::time::system_clock::now();
+  CertCache cache(16, 1_h);
+  cache.insert(MakeCert("/a/KEY/1/self/v=1", now - 1_h, now + 1_day));
+  cache.insert(MakeCert("/ab/KEY/1/self/v=1", now - 1_h, now + 1_day));
+  BOOST_CHECK_EQUAL(cache.size(), 2);
+
+  auto cert = cache.find("/a/KEY/1");
+  BOOST_REQUIRE(cert != nullptr);
+  BOOST_CHECK_EQUAL(cert->getName(), ndn::Name("/a/KEY/1/self/v=1"));
+  BOOST_CHECK(cache.find("/a/KEY/1/self/v=1") != nullptr);
+  BOOST_CHECK(cache.find("/a/KEY/2") == nullptr);
+  BOOST_CHECK(cache.find("/b/KEY/1") == nullptr);
+  BOOST_CHECK_EQUAL(cache.getStats().hits, 2);
+  BOOST_CHECK_EQUAL(cache.getStats().misses, 2);
+
+  cache.erase("/a/KEY/1/self/v=1");
+  BOOST_CHECK(cache.find("/a/KEY/1") == nullptr);
+  BOOST_CHECK_EQUAL(cache.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(ValidityPeriod) {
+  auto now = ndn::time::system_clock::now();
+  CertCache cache(16, 1_h);
+  cache.insert(MakeCert("/expired/KEY/1/self/v=1", now - 2_day, now - 1_day));
+  cache.insert(MakeCert("/future/KEY/1/self/v=1", now + 1_day, now + 2_day));
+  BOOST_CHECK_EQUAL(cache.size(), 0);
+
+  cache.insert(MakeCert("/expiring/KEY/1/self/v=1", now - 1_h, now + 50_ms));
+  BOOST_CHECK(cache.find("/expiring/KEY/1") != nullptr);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  BOOST_CHECK(cache.find("/expiring/KEY/1") == nullptr);
+  BOOST_CHECK_EQUAL(cache.getStats().expirations, 1);
+  BOOST_CHECK_EQUAL(cache.size(), 0);
+
+  CertCache shortLived(16, 50_ms);
+  shortLived.insert(MakeCert("/a/KEY/1/self/v=1", now - 1_h, now + 1_day));
+  BOOST_CHECK(shortLived.find("/a/KEY/1") != nullptr);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  BOOST_CHECK(shortLived.find("/a/KEY/1") == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(Eviction) {
+  auto now = ndn::time::system_clock::now();
+  CertCache cache(2, 1_h);
+  cache.insert(MakeCert("/a/KEY/1/self/v=1", now - 1_h, now + 1_day));
+  cache.insert(MakeCert("/b/KEY/1/self/v=1", now - 1_h, now + 1_day));
+  BOOST_CHECK(cache.find("/a/KEY/1") != nullptr);  // /b becomes least recently used
+  cache.insert(MakeCert("/c/KEY/1/self/v=1", now - 1_h, now + 1_day));
+  BOOST_CHECK_EQUAL(cache.size(), 2);
+  BOOST_CHECK_EQUAL(cache.getStats().evictions, 1);
+  BOOST_CHECK(cache.find("/a/KEY/1") != nullptr);
+  BOOST_CHECK(cache.find("/b/KEY/1") == nullptr);
+  BOOST_CHECK(cache.find("/c/KEY/1") != nullptr);
+
+  CertCache disabled(0, 1_h);
+  disabled.insert(MakeCert("/a/KEY/1/self/v=1", now - 1_h, now + 1_day));
+  BOOST_CHECK_EQUAL(disabled.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(Negative) {
+  using ndn::security::ValidationError;
+  lvs::NegativeCertCache cache(2);
+  cache.insert("/a/KEY/1", ValidationError::Code::CANNOT_RETRIEVE_CERT, 50_ms);
+  cache.insert("/b/KEY/1", ValidationError::Code::MALFORMED_CERT, 1_h);
+  cache.insert("/c/KEY/1", ValidationError::Code::MALFORMED_CERT, 0_ms);
+  BOOST_CHECK_EQUAL(cache.size(), 2);
+
+  BOOST_CHECK_EQUAL(cache.find("/a/KEY/1").value().getCode(), ValidationError::Code::CANNOT_RETRIEVE_CERT);
+  BOOST_CHECK(!cache.find("/a/KEY").has_value());
+  BOOST_CHECK(!cache.find("/c/KEY/1").has_value());
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  BOOST_CHECK(!cache.find("/a/KEY/1").has_value());
+  BOOST_CHECK_EQUAL(cache.find("/b/KEY/1").value().getCode(), ValidationError::Code::MALFORMED_CERT);
+  BOOST_CHECK_EQUAL(cache.getStats().hits, 2);
+  BOOST_CHECK_EQUAL(cache.getStats().misses, 3);
+
+  cache.insert("/c/KEY/1", ValidationError::Code::MALFORMED_CERT, 1_h);
+  cache.insert("/d/KEY/1", ValidationError::Code::MALFORMED_CERT, 1_h);
+  BOOST_CHECK_EQUAL(cache.size(), 2);
+  BOOST_CHECK(!cache.find("/b/KEY/1").has_value());
+  BOOST_CHECK_EQUAL(cache.getStats().evictions, 1);
+}
+
+BOOST_AUTO_TEST_CASE(ValidationResult) {
+  auto now = ndn::time::system_clock::now();
+  lvs::ValidationResultCache cache(2);
+  cache.insert("/a/sha256digest=0000000000000000000000000000000000000000000000000000000000000000",
+               now + 1_h);
+  cache.insert("/b", now + 50_ms);
+  cache.insert("/c", now - 1_h);
+  BOOST_CHECK_EQUAL(cache.size(), 2);
+  BOOST_CHECK(!cache.contains("/a"));
+  BOOST_CHECK(!cache.contains("/c"));
+  BOOST_CHECK(cache.contains("/b"));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  BOOST_CHECK(!cache.contains("/b"));
+  BOOST_CHECK(cache.contains("/a/sha256digest=0000000000000000000000000000000000000000000000000000000000000000"));
+  BOOST_CHECK_EQUAL(cache.getStats().hits, 2);
+  BOOST_CHECK_EQUAL(cache.getStats().misses, 3);
+  BOOST_CHECK_EQUAL(cache.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(Concurrent) {
+  BOOST_CHECK_EQUAL(lvs::keyNameOf("/a/KEY/1/self/v=1"), ndn::Name("/a/KEY/1"));
+  BOOST_CHECK_EQUAL(lvs::keyNameOf("/a/KEY/1"), ndn::Name("/a/KEY/1"));
+
+  auto now = ndn::time::system_clock::now();
+  lvs::ConcurrentCertCache cache(256, 1_h, 4);
+  std::vector<std::thread> threads;
+  std::atomic<int> found{0};
+  for(int t = 0; t < 4; t ++){
+    threads.emplace_back([&cache, &found, now, t]{
+      for(int i = 0; i < 8; i ++){
+        auto prefix = "/t" + std::to_string(t) + "/KEY/" + std::to_string(i);
+        cache.insert(MakeCert(prefix + "/self/v=1", now - 1_h, now + 1_day));
+        if(cache.find(prefix) != nullptr){
+          found ++;
+        }
+      }
+    });
+  }
+  for(auto& thread: threads){
+    thread.join();
+  }
+  BOOST_CHECK_EQUAL(found, 32);
+  BOOST_CHECK_EQUAL(cache.size(), 32);
+  BOOST_CHECK(cache.find("/t3/KEY/7/self/v=1") != nullptr);
+  BOOST_CHECK_EQUAL(cache.getStats().hits, 33);
+
+  cache.erase("/t3/KEY/7/self/v=1");
+  BOOST_CHECK(cache.find("/t3/KEY/7") == nullptr);
+  cache.clear();
+  BOOST_CHECK_EQUAL(cache.size(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END() // TestCertCache
+
+} // namespace tests
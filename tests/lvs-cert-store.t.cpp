@@ -0,0 +1,74 @@
+#include <boost-test.hpp>
+
+#include "lvs-cert-store.hpp"
+#include <boost/filesystem.hpp>
+
+namespace tests {
+
+using lvs::CertStore;
+using namespace ndn::time_literals;
+
+// Certificates must have some content to decode
+static const uint8_t PUBLIC_KEY[] = {0x30, 0x00};
+
+static ndn::security::Certificate
+MakeCert(const std::string& name, ndn::time::system_clock::time_point notAfter)
+{
+  ndn::security::Certificate cert;
+  cert.setName(ndn::Name(name));
+  cert.setContent(PUBLIC_KEY);
+  ndn::SignatureInfo info(ndn::tlv::SignatureSha256WithEcdsa, ndn::KeyLocator(ndn::Name("/anchor/KEY/1")));
+  info.setValidityPeriod(ndn::security::ValidityPeriod(ndn::time::system_clock::now() - 1_day, notAfter));
+  cert.setSignatureInfo(info);
+  cert.setSignatureValue(std::make_shared<ndn::Buffer>(32));
+  return cert;
+}
+
+class CertStoreFixture {
+public:
+  CertStoreFixture()
+  {
+    boost::filesystem::create_directories(dir);
+    boost::filesystem::remove(path);
+  }
+
+  ~CertStoreFixture()
+  {
+    boost::filesystem::remove_all(dir);
+  }
+
+protected:
+  const boost::filesystem::path dir = boost::filesystem::path(UNIT_TESTS_TMPDIR) / "cert-store";
+  const std::string path = (dir / "certs.db").string();
+};
+
+BOOST_FIXTURE_TEST_SUITE(TestCertStore, CertStoreFixture)
+
+BOOST_AUTO_TEST_CASE(Reopen) {
+  auto now = ndn::time::system_clock::now();
+  {
+    CertStore store(path);
+    store.insert(MakeCert("/a/KEY/1/self/v=1", now + 1_day));
+    store.insert(MakeCert("/b/KEY/1/self/v=1", now + 1_day));
+    store.insert(MakeCert("/b/KEY/1/self/v=1", now + 2_day));
+    store.insert(MakeCert("/c/KEY/1/self/v=1", now - 1_h));
+    store.erase("/a/KEY/1/self/v=1");
+    BOOST_CHECK_EQUAL(store.size(), 2);
+  }
+
+  CertStore store(path);
+  auto records = store.load();
+  BOOST_REQUIRE_EQUAL(records.size(), 1);
+  BOOST_CHECK_EQUAL(records[0].cert.getName(), ndn::Name("/b/KEY/1/self/v=1"));
+  BOOST_CHECK(records[0].verifiedAt <= ndn::time::system_clock::now());
+  // The expired certificate is gone
+  BOOST_CHECK_EQUAL(store.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(OpenFailure) {
+  BOOST_CHECK_THROW(CertStore((dir / "missing" / "certs.db").string()), CertStore::Error);
+}
+
+BOOST_AUTO_TEST_SUITE_END() // TestCertStore
+
+} // namespace tests
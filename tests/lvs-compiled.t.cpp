@@ -0,0 +1,88 @@
+#include <boost-test.hpp>
+
+#include "lvs-checker.hpp"
+#include "lvs-compiled.hpp"
+#include "schemas/check1-compiled.hpp"
+#include "schemas/check2-compiled.hpp"
+
+namespace tests {
+
+// Enumerate all names of up to max_depth components drawn from alphabet
+static std::vector<ndn::Name>
+MakeNames(const std::vector<std::string>& alphabet, size_t max_depth)
+{
+  auto ret = std::vector<ndn::Name>{ndn::Name()};
+  size_t begin = 0;
+  for(size_t depth = 0; depth < max_depth; depth ++) {
+    size_t end = ret.size();
+    for(size_t i = begin; i < end; i ++) {
+      for(auto&& comp: alphabet) {
+        ret.push_back(ndn::Name(ret[i]).append(ndn::Name::Component::fromEscapedString(comp)));
+      }
+    }
+    begin = end;
+  }
+  return ret;
+}
+
+template<typename Matcher>
+static auto
+CollectMatches(Matcher&& matcher)
+{
+  auto ret = std::vector<std::tuple<std::vector<std::string>, std::map<std::string, ndn::Name::Component>>>();
+  try {
+    while(true) {
+      auto [rule_name, captures] = matcher();
+      ret.emplace_back(*rule_name, captures);
+    }
+  } catch(lvs::StopIteration&) {
+  }
+  return ret;
+}
+
+template<typename Schema>
+static void
+CheckSameAsInterpreter(const std::vector<ndn::Name>& names)
+{
+  auto model = lvs::LvsModel::Parse(tlv::bstring_view(Schema::binary, sizeof(Schema::binary)));
+  BOOST_REQUIRE(model.has_value());
+  auto checker = lvs::Checker(*model, {});
+  auto compiled = lvs::CompiledChecker<Schema>();
+
+  for(auto&& name: names) {
+    BOOST_TEST_CONTEXT("Matching " << name) {
+      BOOST_CHECK(CollectMatches(checker.match(name)) == CollectMatches(compiled.match(name)));
+    }
+  }
+  for(auto&& pkt_name: names) {
+    for(auto&& key_name: names) {
+      if(checker.check(pkt_name, key_name) != compiled.check(pkt_name, key_name)) {
+        BOOST_ERROR("Checking " << pkt_name << " against " << key_name << " differs");
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(TestLvsCompiled)
+
+BOOST_AUTO_TEST_CASE(Check1) {
+  auto checker = tests::compiled::check1::Checker();
+  BOOST_CHECK(checker.check("/a/b/c", "/xxx/yyy/zzz"));
+  BOOST_CHECK(!checker.check("/a/b/c", "/xxx/yyy"));
+
+  CheckSameAsInterpreter<tests::compiled::check1::Schema>(
+    MakeNames({"a", "b", "c", "x", "xxx", "yyy"}, 3));
+}
+
+BOOST_AUTO_TEST_CASE(Check2) {
+  auto checker = tests::compiled::check2::Checker();
+  BOOST_CHECK(checker.check("/example/testApp/randomData/v=1648365523687",
+                            "/example/testApp/KEY/%3E%8C%1F%0EaB3Z"));
+
+  CheckSameAsInterpreter<tests::compiled::check2::Schema>(
+    MakeNames({"example", "testApp", "KEY", "x"}, 4));
+}
+
+BOOST_AUTO_TEST_SUITE_END() // TestLvsCompiled
+
+} // namespace tests
@@ -0,0 +1,54 @@
+#include <boost-test.hpp>
+
+#include <thread>
+#include "lvs-checker.hpp"
+#include "lvs-instrumentation.hpp"
+#include "schemas/check1-compiled.hpp"
+
+namespace tests {
+
+using lvs::instrumentation::Counter;
+
+BOOST_AUTO_TEST_SUITE(TestInstrumentation)
+
+BOOST_AUTO_TEST_CASE(CheckCounters) {
+  using Schema = tests::compiled::check1::Schema;
+  auto model = lvs::LvsModel::Parse(tlv::bstring_view(Schema::binary, sizeof(Schema::binary)));
+  BOOST_REQUIRE(model.has_value());
+  auto checker = lvs::Checker(*model, {});
+
+  lvs::instrumentation::reset();
+  BOOST_CHECK(checker.check("/a/b/c", "/xxx/yyy/zzz"));
+  // Counted on another thread, which exits before the snapshot
+  std::thread([&checker] { checker.check("/a/b/c", "/xxx/yyy"); }).join();
+  // Matches both nodes of #r1, which counts one rejection
+  BOOST_CHECK(!checker.check("/x/b/x", "/xxx/yyy"));
+  BOOST_CHECK(!checker.check("/q", "/xxx/yyy/zzz"));
+  auto stats = lvs::instrumentation::snapshot();
+
+  if(!lvs::instrumentation::enabled()) {
+    BOOST_CHECK_EQUAL(stats[Counter::CHECKS], 0);
+    BOOST_CHECK(stats.rules.empty());
+    return;
+  }
+  BOOST_CHECK_EQUAL(stats[Counter::CHECKS], 4);
+  BOOST_CHECK_EQUAL(stats[Counter::CHECKS_ACCEPTED], 1);
+  BOOST_CHECK_EQUAL(stats[Counter::CHECKS_UNMATCHED], 1);
+  BOOST_CHECK_GT(stats[Counter::EDGES_TRIED], 6);
+  BOOST_CHECK_GT(stats[Counter::BACKTRACKS], 0);
+  BOOST_CHECK_GT(stats[Counter::CONSTRAINT_EVALS], 0);
+  BOOST_CHECK_EQUAL(stats[Counter::USER_FN_CALLS], 0);
+  BOOST_CHECK_EQUAL(stats.rules["#r1"].accepted, 1);
+  BOOST_CHECK_EQUAL(stats.rules["#r1"].rejected, 2);
+
+  std::ostringstream os;
+  stats.print(os);
+  BOOST_CHECK(os.str().find("lvs_checks 4\n") != std::string::npos);
+
+  lvs::instrumentation::reset();
+  BOOST_CHECK_EQUAL(lvs::instrumentation::snapshot()[Counter::CHECKS], 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
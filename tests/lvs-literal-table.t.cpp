@@ -0,0 +1,76 @@
+#include <boost-test.hpp>
+
+#include "lvs-literal-table.hpp"
+
+namespace tests {
+
+using lvs::LiteralTable;
+
+static std::vector<uint8_t>
+MakeLiteral(uint8_t type, const std::string& value)
+{
+  auto ret = std::vector<uint8_t>{type, uint8_t(value.size())};
+  ret.insert(ret.end(), value.begin(), value.end());
+  return ret;
+}
+
+static std::vector<LiteralTable::Kernel>
+SupportedKernels()
+{
+  auto ret = std::vector<LiteralTable::Kernel>{LiteralTable::Kernel::SCALAR};
+  if(LiteralTable::BestKernel() != LiteralTable::Kernel::SCALAR) {
+    ret.push_back(LiteralTable::Kernel::SSE2);
+  }
+  if(LiteralTable::BestKernel() == LiteralTable::Kernel::AVX2) {
+    ret.push_back(LiteralTable::Kernel::AVX2);
+  }
+  return ret;
+}
+
+BOOST_AUTO_TEST_SUITE(TestLiteralTable)
+
+BOOST_AUTO_TEST_CASE(Find) {
+  auto literals = std::vector<std::vector<uint8_t>>();
+  for(int i = 0; i < 37; i ++) {
+    literals.push_back(MakeLiteral(0x08, "dev-" + std::to_string(1000 + i)));
+  }
+  literals.push_back(MakeLiteral(0x08, "a-rather-long-device-identifier-1"));
+  literals.push_back(MakeLiteral(0x08, "a-rather-long-device-identifier-2"));
+  literals.push_back(MakeLiteral(0x20, "dev-1000"));
+  literals.push_back(MakeLiteral(0x08, ""));
+  literals.push_back(MakeLiteral(0x08, "dev-1000"));  // Duplicate: first id wins
+
+  LiteralTable table;
+  BOOST_CHECK(table.empty());
+  for(size_t i = 0; i < literals.size(); i ++) {
+    BOOST_CHECK(table.insert(tlv::bstring_view(literals[i].data(), literals[i].size()), i));
+  }
+  BOOST_CHECK(!table.empty());
+
+  for(auto kernel: SupportedKernels()) {
+    for(size_t i = 0; i + 1 < literals.size(); i ++) {
+      auto& lit = literals[i];
+      BOOST_CHECK_EQUAL(table.find(lit[0], lit.data() + 2, lit.size() - 2, kernel).value_or(-1), i);
+    }
+    auto miss = MakeLiteral(0x08, "a-rather-long-device-identifier-3");
+    BOOST_CHECK(!table.find(0x08, miss.data() + 2, miss.size() - 2, kernel).has_value());
+    miss = MakeLiteral(0x08, "dev-2000");
+    BOOST_CHECK(!table.find(0x08, miss.data() + 2, miss.size() - 2, kernel).has_value());
+    miss = MakeLiteral(0x21, "dev-1000");
+    BOOST_CHECK(!table.find(0x21, miss.data() + 2, miss.size() - 2, kernel).has_value());
+  }
+
+  BOOST_CHECK_EQUAL(table.find(ndn::Name::Component("dev-1005")).value_or(-1), 5);
+  BOOST_CHECK(!table.find(ndn::Name::Component("dev-10050")).has_value());
+}
+
+BOOST_AUTO_TEST_CASE(Malformed) {
+  std::uint8_t truncated[] = {0x08, 0x05, 'a', 'b'};
+  LiteralTable table;
+  BOOST_CHECK(!table.insert(tlv::bstring_view(truncated, sizeof(truncated)), 0));
+  BOOST_CHECK(table.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END() // TestLiteralTable
+
+} // namespace tests
@@ -0,0 +1,64 @@
+#include <boost-test.hpp>
+
+#include "lvs-replay-filter.hpp"
+
+namespace tests {
+
+using lvs::ReplayFilter;
+using namespace ndn::time_literals;
+
+BOOST_AUTO_TEST_SUITE(TestReplayFilter)
+
+BOOST_AUTO_TEST_CASE(Timestamp) {
+  auto now = ndn::time::system_clock::now();
+  ReplayFilter filter(16, 1_min, 4);
+  BOOST_CHECK(!filter.insert("/a/KEY/1", {now - 2_min, std::nullopt, std::nullopt}));
+  BOOST_CHECK(!filter.insert("/a/KEY/1", {now + 2_min, std::nullopt, std::nullopt}));
+  BOOST_CHECK(filter.insert("/a/KEY/1", {now, std::nullopt, std::nullopt}));
+  BOOST_CHECK(!filter.check("/a/KEY/1", {now, std::nullopt, std::nullopt}));
+  BOOST_CHECK(!filter.check("/a/KEY/1", {now - 1_s, std::nullopt, std::nullopt}));
+  BOOST_CHECK(filter.check("/a/KEY/1", {now + 1_s, std::nullopt, std::nullopt}));
+  BOOST_CHECK(filter.check("/b/KEY/1", {now, std::nullopt, std::nullopt}));
+}
+
+BOOST_AUTO_TEST_CASE(SeqNumAndNonce) {
+  ReplayFilter filter(16, 0_s, 2);
+  BOOST_CHECK(filter.insert("/a/KEY/1", {std::nullopt, 5, std::nullopt}));
+  BOOST_CHECK(!filter.insert("/a/KEY/1", {std::nullopt, 5, std::nullopt}));
+  BOOST_CHECK(filter.insert("/a/KEY/1", {std::nullopt, 6, std::nullopt}));
+
+  std::vector<uint8_t> n1{1}, n2{2}, n3{3};
+  BOOST_CHECK(filter.insert("/a/KEY/1", {std::nullopt, std::nullopt, n1}));
+  BOOST_CHECK(!filter.insert("/a/KEY/1", {std::nullopt, std::nullopt, n1}));
+  BOOST_CHECK(filter.insert("/a/KEY/1", {std::nullopt, std::nullopt, n2}));
+  BOOST_CHECK(filter.insert("/a/KEY/1", {std::nullopt, std::nullopt, n3}));
+  // Only the two latest nonces are kept
+  BOOST_CHECK(filter.check("/a/KEY/1", {std::nullopt, std::nullopt, n1}));
+  BOOST_CHECK(!filter.check("/a/KEY/1", {std::nullopt, std::nullopt, n3}));
+}
+
+BOOST_AUTO_TEST_CASE(Eviction) {
+  ReplayFilter filter(2, 0_s, 4);
+  BOOST_CHECK(filter.insert("/a/KEY/1", {std::nullopt, 1, std::nullopt}));
+  BOOST_CHECK(filter.insert("/b/KEY/1", {std::nullopt, 1, std::nullopt}));
+  BOOST_CHECK(filter.insert("/a/KEY/1", {std::nullopt, 2, std::nullopt}));  // /b becomes least recently used
+  BOOST_CHECK(filter.insert("/c/KEY/1", {std::nullopt, 1, std::nullopt}));
+  BOOST_CHECK_EQUAL(filter.size(), 2);
+  BOOST_CHECK(!filter.check("/a/KEY/1", {std::nullopt, 2, std::nullopt}));
+  BOOST_CHECK(filter.check("/b/KEY/1", {std::nullopt, 1, std::nullopt}));
+}
+
+BOOST_AUTO_TEST_CASE(NoStamp) {
+  ReplayFilter filter(16, 1_min, 4);
+  BOOST_CHECK(!filter.check("/a/KEY/1", {std::nullopt, std::nullopt, std::nullopt}));
+  BOOST_CHECK(!filter.insert("/a/KEY/1", {std::nullopt, std::nullopt, std::nullopt}));
+  BOOST_CHECK_EQUAL(filter.size(), 0);
+
+  ReplayFilter stateless(0, 0_s, 0);
+  BOOST_CHECK(!stateless.insert("/a/KEY/1", {std::nullopt, std::nullopt, std::nullopt}));
+  BOOST_CHECK(stateless.insert("/a/KEY/1", {std::nullopt, 1, std::nullopt}));
+}
+
+BOOST_AUTO_TEST_SUITE_END() // TestReplayFilter
+
+} // namespace tests
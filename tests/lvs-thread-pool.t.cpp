@@ -0,0 +1,49 @@
+#include <boost-test.hpp>
+
+#include "lvs-thread-pool.hpp"
+#include <atomic>
+#include <future>
+
+namespace tests {
+
+using lvs::ThreadPool;
+
+BOOST_AUTO_TEST_SUITE(TestThreadPool)
+
+BOOST_AUTO_TEST_CASE(RunAll) {
+  std::atomic<int> done{0};
+  std::promise<void> finished;
+  {
+    ThreadPool pool(4, 100);
+    BOOST_CHECK_EQUAL(pool.size(), 4);
+    for(int i = 0; i < 100; i ++) {
+      BOOST_CHECK(pool.submit([&] {
+        if(++ done == 100) {
+          finished.set_value();
+        }
+      }));
+    }
+    finished.get_future().wait();
+  }
+  BOOST_CHECK_EQUAL(done.load(), 100);
+}
+
+BOOST_AUTO_TEST_CASE(QueueDepth) {
+  std::promise<void> release;
+  auto released = release.get_future().share();
+  std::promise<void> started;
+  ThreadPool pool(1, 2);
+  BOOST_CHECK(pool.submit([&] {
+    started.set_value();
+    released.wait();
+  }));
+  started.get_future().wait();
+  BOOST_CHECK(pool.submit([] {}));
+  BOOST_CHECK(pool.submit([] {}));
+  BOOST_CHECK(!pool.submit([] {}));
+  release.set_value();
+}
+
+BOOST_AUTO_TEST_SUITE_END() // TestThreadPool
+
+} // namespace tests
@@ -0,0 +1,55 @@
+#include <boost-test.hpp>
+
+#include "lvs-trust-anchors.hpp"
+
+namespace tests {
+
+using lvs::TrustAnchorSet;
+
+static ndn::security::Certificate
+MakeAnchor(const std::string& name)
+{
+  ndn::security::Certificate cert;
+  cert.setName(ndn::Name(name));
+  return cert;
+}
+
+BOOST_AUTO_TEST_SUITE(TestTrustAnchors)
+
+BOOST_AUTO_TEST_CASE(Find) {
+  TrustAnchorSet anchors;
+  anchors.insert(MakeAnchor("/org1/KEY/1/self/v=1"));
+  anchors.insert(MakeAnchor("/org1/KEY/1/self/v=2"));
+  anchors.insert(MakeAnchor("/org2/KEY/1/self/v=1"));
+  anchors.insert(MakeAnchor("/org2/KEY/1/self/v=1"));
+  BOOST_CHECK_EQUAL(anchors.size(), 3);
+
+  BOOST_CHECK_EQUAL(anchors.find("/org1/KEY/1")->getName(), ndn::Name("/org1/KEY/1/self/v=2"));
+  BOOST_CHECK_EQUAL(anchors.find("/org1/KEY/1/self/v=1")->getName(), ndn::Name("/org1/KEY/1/self/v=1"));
+  BOOST_CHECK_EQUAL(anchors.find("/org2/KEY/1")->getName(), ndn::Name("/org2/KEY/1/self/v=1"));
+  BOOST_CHECK(anchors.find("/org1/KEY/2") == nullptr);
+  BOOST_CHECK(anchors.find("/org1/KEY/1/self/v=1/extra") == nullptr);
+  BOOST_CHECK(anchors.find("/org3") == nullptr);
+  BOOST_CHECK_EQUAL(anchors.list().size(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(Erase) {
+  TrustAnchorSet anchors;
+  anchors.insert(MakeAnchor("/org1/KEY/1/self/v=1"));
+  anchors.insert(MakeAnchor("/org1/KEY/1/self/v=2"));
+  BOOST_CHECK(!anchors.erase("/org1/KEY/1/self"));
+  BOOST_CHECK(!anchors.erase("/org1/KEY/1/self/v=3"));
+
+  BOOST_CHECK(anchors.erase("/org1/KEY/1/self/v=2"));
+  BOOST_CHECK_EQUAL(anchors.size(), 1);
+  BOOST_CHECK_EQUAL(anchors.find("/org1/KEY/1")->getName(), ndn::Name("/org1/KEY/1/self/v=1"));
+
+  BOOST_CHECK(anchors.erase("/org1/KEY/1/self/v=1"));
+  BOOST_CHECK_EQUAL(anchors.size(), 0);
+  BOOST_CHECK(anchors.find("/org1") == nullptr);
+  BOOST_CHECK(anchors.find("/") == nullptr);
+}
+
+BOOST_AUTO_TEST_SUITE_END() // TestTrustAnchors
+
+} // namespace tests
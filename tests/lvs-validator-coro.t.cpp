@@ -0,0 +1,84 @@
+#include <boost-test.hpp>
+
+#include "lvs-validator-coro.hpp"
+#include "lvs-validator-fixture.hpp"
+
+namespace tests {
+
+// A coroutine that starts at once and is not awaited
+struct Detached {
+  struct promise_type {
+    Detached
+    get_return_object()
+    {
+      return {};
+    }
+
+    std::suspend_never
+    initial_suspend() noexcept
+    {
+      return {};
+    }
+
+    std::suspend_never
+    final_suspend() noexcept
+    {
+      return {};
+    }
+
+    void
+    return_void()
+    {
+    }
+
+    void
+    unhandled_exception()
+    {
+      std::terminate();
+    }
+  };
+};
+
+static Detached
+AwaitValidation(Validator& validator, const ndn::Data& data, std::optional<lvs::ValidationResult>& result)
+{
+  result = co_await lvs::co_validate(validator, data);
+}
+
+BOOST_FIXTURE_TEST_SUITE(TestValidatorCoro, ValidatorFixture)
+
+BOOST_AUTO_TEST_CASE(Await) {
+  auto cert = makeAuthorCert("/example/alice");
+  Validator validator(schema(), face, anchor);
+
+  // Signed by the anchor, so it finishes without suspending
+  std::optional<lvs::ValidationResult> result;
+  AwaitValidation(validator, cert, result);
+  BOOST_REQUIRE(result.has_value());
+  BOOST_CHECK(*result);
+
+  // Waits on the certificate
+  auto data = makeData("/example/alice/data/1", cert.getName());
+  result.reset();
+  AwaitValidation(validator, data, result);
+  advance();
+  BOOST_CHECK(!result.has_value());
+  face.receive(cert);
+  advance();
+  BOOST_REQUIRE(result.has_value());
+  BOOST_CHECK(*result);
+
+  // A failure carries the error
+  auto bad = makeData("/example/bob/data/1", cert.getName());
+  result.reset();
+  AwaitValidation(validator, bad, result);
+  advance();
+  BOOST_REQUIRE(result.has_value());
+  BOOST_CHECK(!*result);
+  BOOST_REQUIRE(result->error.has_value());
+  BOOST_CHECK_EQUAL(result->error->getCode(), ValidationError::Code::POLICY_ERROR);
+}
+
+BOOST_AUTO_TEST_SUITE_END() // TestValidatorCoro
+
+} // namespace tests
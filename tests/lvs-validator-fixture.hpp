@@ -0,0 +1,144 @@
+#pragma once
+
+#include "lvs-validator.hpp"
+#include "schemas/loop-compiled.hpp"
+#include "schemas/validator-compiled.hpp"
+#include <ndn-cxx/util/dummy-client-face.hpp>
+#include <boost/asio/io_service.hpp>
+
+namespace tests {
+
+using lvs::Validator;
+using lvs::ValidatorOptions;
+using ndn::security::ValidationError;
+using namespace ndn::time_literals;
+
+// tests/schemas/validator.lvs: check2.lvs with #data signed by #author_cert
+// tests/schemas/loop.lvs: also lets an #author_cert sign another #author_cert of the same author
+using ValidatorSchema = compiled::validator::Schema;
+using LoopSchema = compiled::loop::Schema;
+
+// Validators on a DummyClientFace, with keys in an in-memory KeyChain.
+// Certificate Interests are only answered when a test does so.
+class ValidatorFixture {
+public:
+  struct Outcome {
+    ndn::Name name;
+    std::optional<ValidationError> error;
+  };
+
+  ValidatorFixture():
+    keyChain("pib-memory:", "tpm-memory:"),
+    face(io, keyChain, {true, false})
+  {
+    anchorId = keyChain.createIdentity("/example");
+    anchor = anchorId.getDefaultKey().getDefaultCertificate();
+  }
+
+  static tlv::bstring_view
+  schema()
+  {
+    return tlv::bstring_view(ValidatorSchema::binary, sizeof(ValidatorSchema::binary));
+  }
+
+  static tlv::bstring_view
+  loopSchema()
+  {
+    return tlv::bstring_view(LoopSchema::binary, sizeof(LoopSchema::binary));
+  }
+
+  static ndn::Name
+  certName(const ndn::security::Key& key)
+  {
+    return ndn::Name(key.getName()).append("example").appendVersion(1);
+  }
+
+  // The certificate of key, signed by signer and valid for a year
+  ndn::security::Certificate
+  makeCert(const ndn::security::Key& key, ndn::security::SigningInfo signer)
+  {
+    auto now = ndn::time::system_clock::now();
+    ndn::security::Certificate cert;
+    cert.setName(certName(key));
+    cert.setContentType(ndn::tlv::ContentType_Key);
+    cert.setFreshnessPeriod(1_h);
+    cert.setContent(key.getPublicKey());
+    ndn::SignatureInfo info;
+    info.setValidityPeriod(ndn::security::ValidityPeriod(now - 1_day, now + 365_day));
+    keyChain.sign(cert, signer.setSignatureInfo(info));
+    return cert;
+  }
+
+  ndn::security::Certificate
+  makeAuthorCert(const ndn::Name& identity)
+  {
+    auto key = keyChain.createIdentity(identity).getDefaultKey();
+    return makeCert(key, ndn::signingByIdentity(anchorId));
+  }
+
+  ndn::Data
+  makeData(const ndn::Name& name, const ndn::Name& signer)
+  {
+    ndn::Data data(name);
+    data.setFreshnessPeriod(1_s);
+    keyChain.sign(data, ndn::signingByCertificate(signer));
+    return data;
+  }
+
+  void
+  validate(Validator& validator, const ndn::Data& data,
+           lvs::ValidationPriority priority = lvs::ValidationPriority::NORMAL)
+  {
+    validator.validate(data,
+      [this](const ndn::Data& data) {
+        outcomes.push_back({data.getName(), std::nullopt});
+      },
+      [this](const ndn::Data& data, const ValidationError& error) {
+        outcomes.push_back({data.getName(), error});
+      },
+      priority);
+  }
+
+  void
+  validate(Validator& validator, const ndn::Interest& interest)
+  {
+    validator.validate(interest,
+      [this](const ndn::Interest& interest) {
+        outcomes.push_back({interest.getName(), std::nullopt});
+      },
+      [this](const ndn::Interest& interest, const ValidationError& error) {
+        outcomes.push_back({interest.getName(), error});
+      });
+  }
+
+  // Answer certificate Interests with these certificates from now on
+  void
+  serve(const std::vector<ndn::security::Certificate>& certs)
+  {
+    face.onSendInterest.connect([this, certs](const ndn::Interest& interest) {
+      for(auto&& cert: certs) {
+        if(interest.matchesData(cert)) {
+          io.post([this, cert]{ face.receive(cert); });
+        }
+      }
+    });
+  }
+
+  // Run the face until there is nothing left to do
+  void
+  advance()
+  {
+    io.restart();
+    io.poll();
+  }
+
+protected:
+  boost::asio::io_service io;
+  ndn::KeyChain keyChain;
+  ndn::util::DummyClientFace face;
+  ndn::security::Identity anchorId;
+  ndn::security::Certificate anchor;
+  std::vector<Outcome> outcomes;
+};
+
+} // namespace tests
@@ -0,0 +1,630 @@
+#include <boost-test.hpp>
+
+#include "lvs-validator-fixture.hpp"
+#include "lvs-cert-store.hpp"
+#include "lvs-sharded-validator.hpp"
+#include <ndn-cxx/security/interest-signer.hpp>
+#include <boost/filesystem.hpp>
+#include <condition_variable>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <thread>
+
+namespace tests {
+
+BOOST_FIXTURE_TEST_SUITE(TestValidator, ValidatorFixture)
+
+BOOST_AUTO_TEST_CASE(CoalesceFetches) {
+  auto cert = makeAuthorCert("/example/alice");
+  Validator validator(schema(), face, anchor);
+  for(int i = 0; i < 5; i ++) {
+    validate(validator, makeData(ndn::Name("/example/alice/data").appendNumber(i), cert.getName()));
+  }
+  advance();
+  BOOST_REQUIRE_EQUAL(face.sentInterests.size(), 1);
+  BOOST_CHECK(face.sentInterests[0].matchesData(cert));
+  BOOST_CHECK(outcomes.empty());
+
+  face.receive(cert);
+  advance();
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 5);
+  for(auto&& outcome: outcomes) {
+    BOOST_CHECK(!outcome.error.has_value());
+  }
+  BOOST_CHECK_EQUAL(face.sentInterests.size(), 1);
+  BOOST_CHECK_EQUAL(validator.getInFlightCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(NegativeCache) {
+  auto cert = makeAuthorCert("/example/alice");
+  ValidatorOptions options;
+  options.retrievalFailureTtl = 200_ms;
+  Validator validator(schema(), face, anchor, options);
+
+  validate(validator, makeData("/example/alice/data/1", cert.getName()));
+  advance();
+  BOOST_REQUIRE_EQUAL(face.sentInterests.size(), 1);
+  ndn::lp::Nack nack(face.sentInterests[0]);
+  nack.setReason(ndn::lp::NackReason::NO_ROUTE);
+  face.receive(nack);
+  advance();
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 1);
+  BOOST_REQUIRE(outcomes[0].error.has_value());
+  BOOST_CHECK_EQUAL(outcomes[0].error->getCode(), ValidationError::Code::CANNOT_RETRIEVE_CERT);
+  BOOST_CHECK_EQUAL(validator.getNegativeCache().size(), 1);
+
+  // Within the TTL, the failure is remembered without another Interest
+  validate(validator, makeData("/example/alice/data/2", cert.getName()));
+  advance();
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 2);
+  BOOST_REQUIRE(outcomes[1].error.has_value());
+  BOOST_CHECK_EQUAL(outcomes[1].error->getCode(), ValidationError::Code::CANNOT_RETRIEVE_CERT);
+  BOOST_CHECK_EQUAL(face.sentInterests.size(), 1);
+
+  // After it, the certificate is fetched again
+  std::this_thread::sleep_for(std::chrono::milliseconds(250));
+  serve({cert});
+  validate(validator, makeData("/example/alice/data/3", cert.getName()));
+  advance();
+  BOOST_CHECK_EQUAL(face.sentInterests.size(), 2);
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 3);
+  BOOST_CHECK(!outcomes[2].error.has_value());
+}
+
+BOOST_AUTO_TEST_CASE(ChainLoop) {
+  auto alice = keyChain.createIdentity("/example/alice");
+  auto selfKey = alice.getDefaultKey();
+  auto keyA = keyChain.createKey(alice);
+  auto keyB = keyChain.createKey(alice);
+  // A certificate that names itself as its signer, and two that name each other
+  auto selfCert = makeCert(selfKey, ndn::signingByCertificate(certName(selfKey)));
+  auto certA = makeCert(keyA, ndn::signingByCertificate(certName(keyB)));
+  auto certB = makeCert(keyB, ndn::signingByCertificate(certName(keyA)));
+  auto goodKey = keyChain.createKey(alice);
+  auto goodCert = makeCert(goodKey, ndn::signingByIdentity(anchorId));
+  serve({selfCert, certA, certB, goodCert});
+
+  ValidatorOptions options;
+  options.maxInFlightValidations = 4;
+  Validator validator(loopSchema(), face, anchor, options);
+  validate(validator, makeData("/example/alice/data/1", selfCert.getName()));
+  validate(validator, makeData("/example/alice/data/2", certA.getName()));
+  advance();
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 2);
+  for(auto&& outcome: outcomes) {
+    BOOST_REQUIRE(outcome.error.has_value());
+    BOOST_CHECK_EQUAL(outcome.error->getCode(), ValidationError::Code::LOOP_DETECTED);
+  }
+  BOOST_CHECK_EQUAL(validator.getInFlightCount(), 0);
+  size_t sent = face.sentInterests.size();
+
+  // Nothing is left waiting: the failures are remembered, and other chains still validate
+  validate(validator, makeData("/example/alice/data/3", certB.getName()));
+  validate(validator, makeData("/example/alice/data/4", goodCert.getName()));
+  advance();
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 4);
+  BOOST_REQUIRE(outcomes[2].error.has_value());
+  BOOST_CHECK(!outcomes[3].error.has_value());
+  BOOST_CHECK_EQUAL(face.sentInterests.size(), sent + 1);
+  BOOST_CHECK_EQUAL(validator.getInFlightCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(ChainDepth) {
+  auto alice = keyChain.createIdentity("/example/alice");
+  auto key1 = alice.getDefaultKey();
+  auto key2 = keyChain.createKey(alice);
+  auto key3 = keyChain.createKey(alice);
+  auto cert1 = makeCert(key1, ndn::signingByIdentity(anchorId));
+  auto cert2 = makeCert(key2, ndn::signingByCertificate(cert1.getName()));
+  auto cert3 = makeCert(key3, ndn::signingByCertificate(cert2.getName()));
+  serve({cert1, cert2, cert3});
+  auto data = makeData("/example/alice/data/1", cert3.getName());
+
+  ValidatorOptions options;
+  options.maxChainDepth = 2;
+  Validator shallow(loopSchema(), face, anchor, options);
+  validate(shallow, data);
+  advance();
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 1);
+  BOOST_REQUIRE(outcomes[0].error.has_value());
+  BOOST_CHECK_EQUAL(outcomes[0].error->getCode(), ValidationError::Code::EXCEEDED_DEPTH_LIMIT);
+
+  options.maxChainDepth = 3;
+  Validator deep(loopSchema(), face, anchor, options);
+  validate(deep, data);
+  advance();
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 2);
+  BOOST_CHECK(!outcomes[1].error.has_value());
+}
+
+BOOST_AUTO_TEST_CASE(Admission) {
+  using lvs::ValidationPriority;
+  auto cert = makeAuthorCert("/example/alice");
+  ValidatorOptions options;
+  options.maxInFlightValidations = 1;
+  options.maxDeferredValidations = 2;
+  Validator validator(schema(), face, anchor, options);
+
+  // The first validation waits on the certificate and holds the only slot
+  validate(validator, makeData("/example/alice/data/0", cert.getName()));
+  validate(validator, makeData("/example/alice/normal/1", cert.getName()), ValidationPriority::NORMAL);
+  validate(validator, makeData("/example/alice/low/1", cert.getName()), ValidationPriority::LOW);
+  advance();
+  BOOST_CHECK_EQUAL(validator.getInFlightCount(), 1);
+  BOOST_CHECK_EQUAL(validator.getDeferredCount(), 2);
+  BOOST_CHECK(outcomes.empty());
+
+  // When full, a validation displaces one of lower priority, or is refused
+  validate(validator, makeData("/example/alice/high/1", cert.getName()), ValidationPriority::HIGH);
+  validate(validator, makeData("/example/alice/low/2", cert.getName()), ValidationPriority::LOW);
+  BOOST_CHECK_EQUAL(validator.getDeferredCount(), 2);
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 2);
+  BOOST_CHECK_EQUAL(outcomes[0].name, ndn::Name("/example/alice/low/1"));
+  BOOST_CHECK_EQUAL(outcomes[1].name, ndn::Name("/example/alice/low/2"));
+  for(auto&& outcome: outcomes) {
+    BOOST_REQUIRE(outcome.error.has_value());
+    BOOST_CHECK_EQUAL(outcome.error->getCode(), lvs::VALIDATION_OVERLOADED);
+  }
+  outcomes.clear();
+
+  // Completions drain the deferred validations, highest priority first
+  face.receive(cert);
+  advance();
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 3);
+  std::vector<ndn::Name> deferred;
+  for(auto&& outcome: outcomes) {
+    BOOST_CHECK(!outcome.error.has_value());
+    if(!ndn::Name("/example/alice/data").isPrefixOf(outcome.name)) {
+      deferred.push_back(outcome.name);
+    }
+  }
+  BOOST_REQUIRE_EQUAL(deferred.size(), 2);
+  BOOST_CHECK_EQUAL(deferred[0], ndn::Name("/example/alice/high/1"));
+  BOOST_CHECK_EQUAL(deferred[1], ndn::Name("/example/alice/normal/1"));
+  BOOST_CHECK_EQUAL(validator.getInFlightCount(), 0);
+  BOOST_CHECK_EQUAL(validator.getDeferredCount(), 0);
+  BOOST_CHECK_EQUAL(face.sentInterests.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(Destroy) {
+  auto cert = makeAuthorCert("/example/alice");
+  {
+    ValidatorOptions options;
+    options.workerThreads = 1;
+    Validator validator(schema(), face, anchor, options);
+    // One on a worker, one waiting on a certificate
+    validate(validator, cert);
+    validate(validator, makeData("/example/alice/data/1", cert.getName()));
+  }
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 2);
+  for(auto&& outcome: outcomes) {
+    BOOST_REQUIRE(outcome.error.has_value());
+    BOOST_CHECK_EQUAL(outcome.error->getCode(), lvs::VALIDATION_OVERLOADED);
+  }
+
+  // What the worker posted back and the answer to the fetch find the validator gone
+  advance();
+  BOOST_REQUIRE_EQUAL(face.sentInterests.size(), 1);
+  face.receive(cert);
+  advance();
+  BOOST_CHECK_EQUAL(outcomes.size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(ReplaceAnchor) {
+  auto cert = makeAuthorCert("/example/alice");
+  serve({cert});
+  Validator validator(schema(), face, anchor);
+  validate(validator, makeData("/example/alice/data/1", cert.getName()));
+  advance();
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 1);
+  BOOST_CHECK(!outcomes[0].error.has_value());
+  BOOST_CHECK_EQUAL(validator.getCertCache().size(), 1);
+  BOOST_CHECK_EQUAL(validator.getPublicKeyCache().size(), 2);
+
+  // Another anchor leaves what is verified alone
+  auto other = keyChain.createIdentity("/other").getDefaultKey().getDefaultCertificate();
+  validator.addTrustAnchor(other);
+  BOOST_CHECK_EQUAL(validator.getCertCache().size(), 1);
+  BOOST_CHECK_EQUAL(validator.getPublicKeyCache().size(), 2);
+
+  // An anchor of the same name with another key must not be verified with the cached key
+  ndn::security::Certificate replaced(anchor);
+  auto newKey = keyChain.createKey(anchorId);
+  replaced.setContent(newKey.getPublicKey());
+  keyChain.sign(replaced, ndn::signingByKey(newKey.getName()));
+  validator.addTrustAnchor(replaced);
+  BOOST_CHECK_EQUAL(validator.getTrustAnchors().size(), 2);
+  BOOST_CHECK_EQUAL(validator.getCertCache().size(), 0);
+  BOOST_CHECK_EQUAL(validator.getPublicKeyCache().size(), 1);
+  auto misses = validator.getPublicKeyCache().getStats().misses;
+  validate(validator, makeData("/example/alice/data/2", cert.getName()));
+  advance();
+  BOOST_CHECK_EQUAL(validator.getPublicKeyCache().getStats().misses, misses + 1);
+  BOOST_CHECK_EQUAL(face.sentInterests.size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(ReloadWhileFetching) {
+  auto dir = boost::filesystem::path(UNIT_TESTS_TMPDIR) / "validator";
+  boost::filesystem::create_directories(dir);
+  auto path = (dir / "certs.db").string();
+  boost::filesystem::remove(path);
+
+  auto bob = makeAuthorCert("/example/bob");
+  auto carol = makeAuthorCert("/example/carol");
+  // The old schema lets alice's first certificate sign her second one, the new one does not
+  auto alice = keyChain.createIdentity("/example/alice");
+  auto key2 = keyChain.createKey(alice);
+  auto alice1 = makeCert(alice.getDefaultKey(), ndn::signingByIdentity(anchorId));
+  auto alice2 = makeCert(key2, ndn::signingByCertificate(alice1.getName()));
+  serve({bob, alice2});
+  ValidatorOptions options;
+  options.resultCacheCapacity = 16;
+  options.certStorePath = path;
+  Validator validator(loopSchema(), face, anchor, options);
+
+  // Fill the caches, then leave the fetch of alice's first certificate pending
+  validate(validator, makeData("/example/bob/data/1", bob.getName()));
+  validate(validator, makeData("/example/carol/data/1", carol.getName()));
+  advance();
+  BOOST_REQUIRE_EQUAL(face.sentInterests.size(), 2);
+  face.receive(ndn::lp::Nack(face.sentInterests[1]));
+  validate(validator, makeData("/example/alice/data/1", alice2.getName()));
+  advance();
+  BOOST_REQUIRE_EQUAL(face.sentInterests.size(), 4);
+  BOOST_CHECK(face.sentInterests[3].matchesData(alice1));
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 2);
+  BOOST_CHECK_EQUAL(validator.getCertCache().size(), 1);
+  BOOST_CHECK_GT(validator.getResultCache().size(), 0);
+  BOOST_CHECK_EQUAL(validator.getNegativeCache().size(), 1);
+
+  auto version = validator.reloadSchema(schema());
+  advance();
+  BOOST_CHECK_EQUAL(validator.getSchemaVersion(), version);
+  BOOST_CHECK_EQUAL(validator.getCertCache().size(), 0);
+  BOOST_CHECK_EQUAL(validator.getResultCache().size(), 0);
+  BOOST_CHECK_EQUAL(validator.getNegativeCache().size(), 0);
+
+  // A validation under the new schema does not join the fetch started under the old one
+  validate(validator, makeData("/example/alice/data/3", alice1.getName()));
+  advance();
+  BOOST_REQUIRE_EQUAL(face.sentInterests.size(), 5);
+  BOOST_CHECK(face.sentInterests[4].matchesData(alice1));
+
+  // Each fetch validates the first certificate under its own schema. The validation started under
+  // the old schema finishes under it, and nothing it verified is kept; what the new schema verified is.
+  face.receive(alice1);
+  advance();
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 4);
+  std::set<std::string> accepted;
+  for(size_t i = 2; i < outcomes.size(); i ++) {
+    BOOST_CHECK(!outcomes[i].error.has_value());
+    accepted.insert(outcomes[i].name.toUri());
+  }
+  BOOST_CHECK(accepted == std::set<std::string>({"/example/alice/data/1", "/example/alice/data/3"}));
+  BOOST_CHECK_EQUAL(validator.getCertCache().size(), 1);
+  // The first certificate and the packet it signed under the new schema
+  BOOST_CHECK_EQUAL(validator.getResultCache().size(), 2);
+  std::set<std::string> stored;
+  for(auto&& record: lvs::CertStore(path).load()) {
+    stored.insert(record.cert.getName().toUri());
+  }
+  BOOST_CHECK(stored == std::set<std::string>({bob.getName().toUri(), alice1.getName().toUri()}));
+
+  // So the next validation fetches the second certificate again, and the new schema rejects it
+  validate(validator, makeData("/example/alice/data/2", alice2.getName()));
+  advance();
+  BOOST_CHECK_EQUAL(face.sentInterests.size(), 6);
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 5);
+  BOOST_CHECK(outcomes[4].error.has_value());
+
+  boost::filesystem::remove_all(dir);
+}
+
+BOOST_AUTO_TEST_CASE(CheckLimits) {
+  auto cert = makeAuthorCert("/example/alice");
+  Validator validator(schema(), face, anchor);
+
+  // The limits come with a copy of the schema, which keeps its version
+  validator.setCheckLimits({1, {}});
+  BOOST_CHECK_EQUAL(validator.getChecker().get_limits().max_steps, 1);
+  BOOST_CHECK_EQUAL(validator.getSchemaVersion(), 1);
+  validate(validator, cert);
+  advance();
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 1);
+  BOOST_REQUIRE(outcomes[0].error.has_value());
+  BOOST_CHECK_EQUAL(outcomes[0].error->getCode(), ValidationError::Code::POLICY_ERROR);
+
+  // A reloaded schema gets them too
+  auto version = validator.reloadSchema(schema());
+  advance();
+  BOOST_CHECK_EQUAL(validator.getSchemaVersion(), version);
+  BOOST_CHECK_EQUAL(validator.getChecker().get_limits().max_steps, 1);
+
+  validator.setCheckLimits({});
+  validate(validator, cert);
+  advance();
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 2);
+  BOOST_CHECK(!outcomes[1].error.has_value());
+}
+
+BOOST_AUTO_TEST_CASE(SignedInterest) {
+  using ndn::security::InterestSigner;
+  auto cert = makeAuthorCert("/example/alice");
+  serve({cert});
+  Validator validator(schema(), face, anchor);
+  InterestSigner signer(keyChain);
+
+  // The schema checks the name without its ParametersSha256Digest component
+  ndn::Interest interest("/example/alice/cmd/1");
+  signer.makeSignedInterest(interest, ndn::signingByCertificate(cert.getName()));
+  BOOST_REQUIRE(interest.getName()[-1].isParametersSha256Digest());
+  validate(validator, interest);
+  advance();
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 1);
+  BOOST_CHECK(!outcomes[0].error.has_value());
+
+  // A replay is refused before any fetch
+  validate(validator, interest);
+  advance();
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 2);
+  BOOST_REQUIRE(outcomes[1].error.has_value());
+  BOOST_CHECK_EQUAL(outcomes[1].error->getCode(), ValidationError::Code::POLICY_ERROR);
+
+  // A sequence number alone is enough
+  ndn::Interest counted("/example/alice/cmd/2");
+  signer.makeSignedInterest(counted, ndn::signingByCertificate(cert.getName()), InterestSigner::WantSeqNum);
+  validate(validator, counted);
+  advance();
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 3);
+  BOOST_CHECK(!outcomes[2].error.has_value());
+
+  // Without timestamp, sequence number or nonce, nothing tells a replay apart
+  ndn::Interest bare("/example/alice/cmd/3");
+  keyChain.sign(bare, ndn::signingByCertificate(cert.getName()));
+  validate(validator, bare);
+  advance();
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 4);
+  BOOST_REQUIRE(outcomes[3].error.has_value());
+  BOOST_CHECK_EQUAL(outcomes[3].error->getCode(), ValidationError::Code::POLICY_ERROR);
+
+  // The name without the digest must still be one the signer may sign
+  ndn::Interest other("/example/bob/cmd/1");
+  signer.makeSignedInterest(other, ndn::signingByCertificate(cert.getName()));
+  validate(validator, other);
+  advance();
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 5);
+  BOOST_REQUIRE(outcomes[4].error.has_value());
+  BOOST_CHECK_EQUAL(outcomes[4].error->getCode(), ValidationError::Code::POLICY_ERROR);
+  BOOST_CHECK_EQUAL(face.sentInterests.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(CommandInterest) {
+  auto cert = makeAuthorCert("/example/alice");
+  serve({cert});
+  Validator validator(schema(), face, anchor);
+
+  // /<name>/<timestamp>/<nonce>/<SignatureInfo>/<SignatureValue>
+  auto makeCommand = [&](const ndn::Name& name, uint64_t nonce) {
+    ndn::Name command(name);
+    command.appendNumber(ndn::time::toUnixTimestamp(ndn::time::system_clock::now()).count()).appendNumber(nonce);
+    ndn::Interest interest(command);
+    keyChain.sign(interest, ndn::signingByCertificate(cert.getName())
+                              .setSignedInterestFormat(ndn::security::SignedInterestFormat::V02));
+    return interest;
+  };
+
+  // The schema checks the name without its four signature components
+  auto interest = makeCommand("/example/alice/cmd/1", 1);
+  BOOST_REQUIRE_EQUAL(interest.getName().size(), 8);
+  validate(validator, interest);
+  advance();
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 1);
+  BOOST_CHECK(!outcomes[0].error.has_value());
+
+  validate(validator, interest);
+  advance();
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 2);
+  BOOST_REQUIRE(outcomes[1].error.has_value());
+  BOOST_CHECK_EQUAL(outcomes[1].error->getCode(), ValidationError::Code::POLICY_ERROR);
+
+  // A later command with another nonce is accepted
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  validate(validator, makeCommand("/example/alice/cmd/1", 2));
+  advance();
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 3);
+  BOOST_CHECK(!outcomes[2].error.has_value());
+
+  // Too short to be a command Interest
+  validate(validator, ndn::Interest("/example/alice"));
+  BOOST_REQUIRE_EQUAL(outcomes.size(), 4);
+  BOOST_REQUIRE(outcomes[3].error.has_value());
+  BOOST_CHECK_EQUAL(outcomes[3].error->getCode(), ValidationError::Code::NO_SIGNATURE);
+}
+
+BOOST_AUTO_TEST_SUITE_END() // TestValidator
+
+// Shards on DummyClientFaces that answer certificate Interests from a list.
+// Outcomes come from the shard threads.
+class ShardedFixture: public ValidatorFixture {
+public:
+  static constexpr size_t SHARDS = 3;
+
+  ShardedFixture()
+  {
+    ValidatorOptions options;
+    // Failures are not remembered, so that trust anchor changes take effect at once
+    options.malformedCertTtl = ndn::time::nanoseconds::zero();
+    options.certPolicyErrorTtl = ndn::time::nanoseconds::zero();
+    auto makeFace = [this](boost::asio::io_service& io) {
+      ndn::util::DummyClientFace::Options faceOptions{true, false};
+      auto face = std::make_unique<ndn::util::DummyClientFace>(io, keyChain, faceOptions);
+      face->onSendInterest.connect([face = face.get(), &io, this](const ndn::Interest& interest) {
+        for(auto&& cert: served) {
+          if(interest.matchesData(cert)) {
+            io.post([face, cert]{ face->receive(cert); });
+          }
+        }
+      });
+      shardFaces.push_back(face.get());
+      return face;
+    };
+    sharded = std::make_unique<lvs::ShardedValidator>(loopSchema(), std::vector<ndn::security::Certificate>{anchor},
+                                                      SHARDS, options, makeFace);
+  }
+
+  void
+  validate(const ndn::Data& data)
+  {
+    sharded->validate(data,
+      [this](const ndn::Data& data) {
+        std::lock_guard<std::mutex> lock(mutex);
+        outcomes.push_back({data.getName(), std::nullopt});
+        cv.notify_all();
+      },
+      [this](const ndn::Data& data, const ValidationError& error) {
+        std::lock_guard<std::mutex> lock(mutex);
+        outcomes.push_back({data.getName(), error});
+        cv.notify_all();
+      });
+  }
+
+  // Wait until there are count outcomes, and take them
+  std::vector<Outcome>
+  waitFor(size_t count)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait_for(lock, std::chrono::seconds(5), [&]{ return outcomes.size() >= count; });
+    return std::move(outcomes);
+  }
+
+  // Interests for cert sent by each shard. Only read after the outcomes depending on them.
+  std::vector<size_t>
+  countInterests(const ndn::security::Certificate& cert)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<size_t> ret;
+    for(auto face: shardFaces) {
+      ret.push_back(std::count_if(face->sentInterests.begin(), face->sentInterests.end(),
+                                  [&](const ndn::Interest& interest){ return interest.matchesData(cert); }));
+    }
+    return ret;
+  }
+
+protected:
+  std::vector<ndn::util::DummyClientFace*> shardFaces;
+  // Filled before the first validation, and not changed after
+  std::vector<ndn::security::Certificate> served;
+  std::unique_ptr<lvs::ShardedValidator> sharded;
+  std::mutex mutex;
+  std::condition_variable cv;
+};
+
+BOOST_FIXTURE_TEST_SUITE(TestShardedValidator, ShardedFixture)
+
+BOOST_AUTO_TEST_CASE(Routing) {
+  // Authors whose keys cover every shard
+  std::vector<ndn::Data> packets;
+  std::vector<ndn::security::Certificate> certs;
+  std::set<size_t> covered;
+  for(int i = 0; covered.size() < SHARDS && i < 100; i ++) {
+    auto identity = ndn::Name("/example").append(ndn::Name::Component::fromNumber(i));
+    auto cert = makeAuthorCert(identity);
+    auto data = makeData(ndn::Name(identity).append("data").append("1"), cert.getName());
+    if(covered.insert(sharded->getShardIndex(data)).second) {
+      certs.push_back(cert);
+      packets.push_back(data);
+    }
+  }
+  BOOST_REQUIRE_EQUAL(covered.size(), SHARDS);
+
+  // A second key of alice, certified by her first one, whose Data go to another shard
+  auto alice = keyChain.createIdentity("/example/alice");
+  auto alice1 = makeCert(alice.getDefaultKey(), ndn::signingByIdentity(anchorId));
+  auto aliceData1 = makeData("/example/alice/data/1", alice1.getName());
+  ndn::security::Certificate alice2;
+  ndn::Data aliceData2;
+  for(int i = 0; i < 100; i ++) {
+    alice2 = makeCert(keyChain.createKey(alice), ndn::signingByCertificate(alice1.getName()));
+    aliceData2 = makeData("/example/alice/data/2", alice2.getName());
+    if(sharded->getShardIndex(aliceData2) != sharded->getShardIndex(aliceData1)) {
+      break;
+    }
+  }
+  BOOST_REQUIRE_NE(sharded->getShardIndex(aliceData2), sharded->getShardIndex(aliceData1));
+
+  served = certs;
+  served.push_back(alice1);
+  served.push_back(alice2);
+  served.push_back(anchor);
+
+  // The same packets from several threads: each key is fetched once, by its own shard
+  std::vector<std::thread> threads;
+  for(int t = 0; t < 4; t ++) {
+    threads.emplace_back([&]{
+      for(auto&& data: packets) {
+        validate(data);
+      }
+    });
+  }
+  for(auto& thread: threads) {
+    thread.join();
+  }
+  auto results = waitFor(4 * packets.size());
+  BOOST_REQUIRE_EQUAL(results.size(), 4 * packets.size());
+  for(auto&& outcome: results) {
+    BOOST_CHECK(!outcome.error.has_value());
+  }
+  for(size_t i = 0; i < certs.size(); i ++) {
+    auto sent = countInterests(certs[i]);
+    BOOST_CHECK_EQUAL(sent[sharded->getShardIndex(packets[i])], 1);
+    BOOST_CHECK_EQUAL(std::accumulate(sent.begin(), sent.end(), size_t(0)), 1);
+  }
+
+  // A certificate fetched by one shard for a chain is found by another in the shared cache
+  validate(aliceData2);
+  BOOST_REQUIRE_EQUAL(waitFor(1).size(), 1);
+  auto hits = sharded->getCertCacheStats().hits;
+  validate(aliceData1);
+  results = waitFor(1);
+  BOOST_REQUIRE_EQUAL(results.size(), 1);
+  BOOST_CHECK(!results[0].error.has_value());
+  BOOST_CHECK_GT(sharded->getCertCacheStats().hits, hits);
+  auto sent = countInterests(alice1);
+  BOOST_CHECK_EQUAL(std::accumulate(sent.begin(), sent.end(), size_t(0)), 1);
+
+  // Trust anchor changes reach every shard
+  sharded->removeTrustAnchor(anchor.getName());
+  for(auto&& data: packets) {
+    validate(data);
+  }
+  results = waitFor(packets.size());
+  BOOST_REQUIRE_EQUAL(results.size(), packets.size());
+  for(auto&& outcome: results) {
+    BOOST_CHECK(outcome.error.has_value());
+  }
+  sharded->addTrustAnchor(anchor);
+  for(auto&& data: packets) {
+    validate(data);
+  }
+  results = waitFor(packets.size());
+  BOOST_REQUIRE_EQUAL(results.size(), packets.size());
+  for(auto&& outcome: results) {
+    BOOST_CHECK(!outcome.error.has_value());
+  }
+
+  // So does a new schema, which does not let alice's first key certify her second one
+  auto version = sharded->reloadSchema(schema());
+  for(int i = 0; i < 500 && sharded->getSchemaVersion() != version; i ++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  BOOST_CHECK_EQUAL(sharded->getSchemaVersion(), version);
+  validate(aliceData2);
+  results = waitFor(1);
+  BOOST_REQUIRE_EQUAL(results.size(), 1);
+  BOOST_CHECK(results[0].error.has_value());
+}
+
+BOOST_AUTO_TEST_SUITE_END() // TestShardedValidator
+
+} // namespace tests
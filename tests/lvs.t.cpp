@@ -1,10 +1,29 @@
 #include <boost-test.hpp>
 
+#include <algorithm>
 #include "lvs-binary.hpp"
 #include "lvs-checker.hpp"
+#include "schemas/check1-compiled.hpp"
+#include "schemas/check2-compiled.hpp"
 
 namespace tests {
 
+// The schemas of Check1 and Check2, from tests/schemas through the headers lvs-codegen makes of them
+// Schema1:
+//   #r1: a/b/c & {c: b, c: a, a: "a"|"x"} <= #r2 | #r3
+//   #r1: a/b/c & {b: "b"|"y"} <= #r2 | #r3
+//   #r2: x/y/z & {x: "xxx"}
+//   #r3: x/y/z & {y: "yyy"}
+// Schema2:
+//   #KEY: "KEY"/_/_/_
+//   #root: "example"
+//   #anchor: #root/#KEY
+//   #author_cert: #root/author/#KEY <= #anchor
+//   #data: #root/author/_/_ <= #author_key
+//   #author_key: #root/author/"KEY"/_
+using Schema1 = compiled::check1::Schema;
+using Schema2 = compiled::check2::Schema;
+
 BOOST_AUTO_TEST_SUITE(TestLvs)
 
 BOOST_AUTO_TEST_CASE(Binary1) {
@@ -126,6 +145,278 @@ BOOST_AUTO_TEST_CASE(Check2) {
   BOOST_CHECK(checker.check(pkt_name, key_name));
 }
 
+BOOST_AUTO_TEST_CASE(CheckKeyPrefix) {
+  tlv::bstring_view buf(Schema2::binary, sizeof(Schema2::binary));
+
+  auto model = lvs::LvsModel::Parse(buf);
+  BOOST_CHECK(model.has_value());
+
+  auto checker = lvs::Checker(*model, {});
+  ndn::Name pkt_name("/example/testApp/randomData/v=1648365523687");
+  BOOST_CHECK(checker.check_key_prefix(pkt_name, "/example/testApp/KEY/%3E%8C%1F%0EaB3Z"));
+  BOOST_CHECK(checker.check_key_prefix(pkt_name, "/example/testApp/KEY"));
+  BOOST_CHECK(checker.check_key_prefix(pkt_name, "/example"));
+  BOOST_CHECK(!checker.check(pkt_name, "/example/testApp/KEY"));
+  BOOST_CHECK(!checker.check_key_prefix(pkt_name, "/example/otherApp/KEY"));
+  BOOST_CHECK(!checker.check_key_prefix(pkt_name, "/example/testApp/KEY/%3E%8C%1F%0EaB3Z/self"));
+  BOOST_CHECK(!checker.check_key_prefix(pkt_name, "/example/KEY"));
+  BOOST_CHECK(!checker.check_key_prefix("/other/testApp/randomData/v=1", "/example"));
+}
+
+BOOST_AUTO_TEST_CASE(MatchAll) {
+  tlv::bstring_view buf(Schema2::binary, sizeof(Schema2::binary));
+
+  auto model = lvs::LvsModel::Parse(buf);
+  BOOST_CHECK(model.has_value());
+
+  auto checker = lvs::Checker(*model, {});
+  auto names = std::vector<ndn::Name>{
+    "/example/testApp/randomData/v=1648365523687",
+    "/example/testApp/KEY/%3E%8C%1F%0EaB3Z",
+    "/example/testApp/randomData/v=1648365523688",
+    "/example",
+    "/example/testApp/KEY/%3E%8C%1F%0EaB3Z/self/v=1",
+    "/example/KEY/%01/self/v=1",
+    "/other/testApp/randomData/v=1",
+    "/example/testApp/randomData/v=1648365523687",
+    "/",
+  };
+
+  using Matches = std::vector<std::tuple<std::vector<std::string>, std::map<std::string, ndn::Name::Component>>>;
+  auto joint = std::vector<Matches>(names.size());
+  checker.match_all(names, [&](size_t index, auto& rule_name, auto& captures) {
+    joint[index].emplace_back(rule_name, captures);
+  });
+
+  size_t matched = 0;
+  for(size_t i = 0; i < names.size(); i ++) {
+    auto expected = Matches();
+    auto matcher = checker.match(names[i]);
+    try {
+      while(true) {
+        auto [rule_name, captures] = matcher();
+        expected.emplace_back(*rule_name, captures);
+      }
+    } catch(lvs::StopIteration&) {
+    }
+    BOOST_CHECK_MESSAGE(joint[i] == expected, "Matches of " << names[i] << " differ");
+    matched += expected.size();
+  }
+  BOOST_CHECK_GT(matched, 0);
+}
+
+BOOST_AUTO_TEST_CASE(SuggestKeys) {
+  tlv::bstring_view buf(Schema2::binary, sizeof(Schema2::binary));
+
+  auto model = lvs::LvsModel::Parse(buf);
+  BOOST_CHECK(model.has_value());
+
+  auto checker = lvs::Checker(*model, {});
+  ndn::Name pkt_name("/example/testApp/randomData/v=1648365523687");
+  auto keys = checker.suggest_keys(pkt_name);
+  BOOST_REQUIRE_EQUAL(keys.size(), 1);
+  BOOST_CHECK_EQUAL(keys[0].rule_name->at(0), "#author_key");
+  BOOST_CHECK_EQUAL(keys[0].prefix(), ndn::Name("/example/testApp/KEY"));
+  BOOST_REQUIRE_EQUAL(keys[0].components.size(), 4);
+  BOOST_CHECK(!keys[0].components[3].has_value());
+  BOOST_CHECK(!keys[0].name().has_value());
+  BOOST_CHECK(checker.check(pkt_name, keys[0].prefix().append("%3E%8C%1F%0EaB3Z")));
+
+  BOOST_CHECK(checker.suggest_keys("/example/testApp").empty());
+
+  auto prefix_keys = checker.suggest_keys("/example/testApp", true);
+  BOOST_REQUIRE_EQUAL(prefix_keys.size(), 2);
+  BOOST_CHECK_EQUAL(prefix_keys[0].prefix(), ndn::Name("/example/KEY"));
+  BOOST_CHECK_EQUAL(prefix_keys[1].prefix(), ndn::Name("/example/testApp/KEY"));
+  BOOST_CHECK_EQUAL(checker.suggest_keys(pkt_name, true).size(), 1);
+
+  BOOST_CHECK_EQUAL(checker.make_name("#root", {}).value(), ndn::Name("/example"));
+  // Anonymous patterns cannot be bound
+  BOOST_CHECK(!checker.make_name("#data", {{"author", ndn::Name::Component("testApp")}}).has_value());
+  BOOST_CHECK(!checker.make_name("#unknown", {}).has_value());
+}
+
+BOOST_AUTO_TEST_CASE(MakeName) {
+  tlv::bstring_view buf(Schema1::binary, sizeof(Schema1::binary));
+
+  auto model = lvs::LvsModel::Parse(buf);
+  BOOST_CHECK(model.has_value());
+
+  auto checker = lvs::Checker(*model, {});
+  auto bind = [](const std::string& a, const std::string& b, const std::string& c) {
+    return std::map<std::string, ndn::Name::Component>{{"a", a}, {"b", b}, {"c", c}};
+  };
+  BOOST_CHECK_EQUAL(checker.make_name("#r1", bind("a", "b", "c")).value(), ndn::Name("/a/b/c"));
+  BOOST_CHECK_EQUAL(checker.make_name("#r1", bind("x", "x", "x")).value(), ndn::Name("/x/x/x"));
+  // Constraint on b is not satisfied by either node of #r1
+  BOOST_CHECK(!checker.make_name("#r1", bind("c", "c", "c")).has_value());
+  BOOST_CHECK(!checker.make_name("#r1", {{"a", ndn::Name::Component("a")}}).has_value());
+
+  auto name = checker.make_name("#r1", bind("a", "y", "c")).value();
+  auto [rule_name, captures] = checker.match(name)();
+  BOOST_CHECK_EQUAL(rule_name->at(0), "#r1");
+}
+
+BOOST_AUTO_TEST_CASE(MalformedModel) {
+  auto model = lvs::LvsModel::Parse(tlv::bstring_view(Schema1::binary, sizeof(Schema1::binary)));
+  BOOST_REQUIRE(model.has_value());
+  auto edge = model->nodes[model->start_id].p_edges.at(0);
+
+  auto bad = *model;
+  bad.nodes[model->start_id].p_edges[0].dest = model->nodes.size();
+  BOOST_CHECK_THROW(lvs::Checker(bad, {}).analyze(), lvs::LvsModelError);
+
+  // Parent links that loop
+  bad = *model;
+  bad.nodes[edge.dest].parent = edge.dest;
+  BOOST_CHECK_THROW(lvs::Checker(bad, {}).analyze(), lvs::LvsModelError);
+
+  // An edge back to the start node
+  bad = *model;
+  edge.dest = model->start_id;
+  bad.nodes[model->nodes[model->start_id].p_edges[0].dest].p_edges.push_back(edge);
+  BOOST_CHECK_THROW(lvs::Checker(bad, {}).analyze(), lvs::LvsModelError);
+
+  bad = *model;
+  bad.nodes[model->start_id].sign_cons.push_back(model->nodes.size());
+  BOOST_CHECK_THROW(lvs::Checker(bad, {}).analyze(), lvs::LvsModelError);
+}
+
+BOOST_AUTO_TEST_CASE(Budget) {
+  tlv::bstring_view buf(Schema1::binary, sizeof(Schema1::binary));
+
+  auto model = lvs::LvsModel::Parse(buf);
+  BOOST_CHECK(model.has_value());
+
+  auto checker = lvs::Checker(*model, {});
+  ndn::Name pkt_name("/a/b/c");
+  ndn::Name key_name("/xxx/yyy/zzz");
+  BOOST_CHECK(checker.check(pkt_name, key_name));
+  auto steps = checker.get_peak_steps();
+  BOOST_CHECK_GT(steps, 0);
+
+  checker.set_limits({steps, {}});
+  BOOST_CHECK(checker.check(pkt_name, key_name));
+  checker.set_limits({steps - 1, {}});
+  BOOST_CHECK_THROW(checker.check(pkt_name, key_name), lvs::BudgetExceeded);
+  BOOST_CHECK_EQUAL(checker.get_peak_steps(), steps);
+
+  // Copies keep the limits and the peak
+  auto copy = checker;
+  BOOST_CHECK_EQUAL(copy.get_peak_steps(), steps);
+  BOOST_CHECK_THROW(copy.check(pkt_name, key_name), lvs::BudgetExceeded);
+  auto moved = std::move(copy);
+  BOOST_CHECK_EQUAL(moved.get_peak_steps(), steps);
+
+  checker.set_limits({0, std::chrono::hours(1)});
+  BOOST_CHECK(checker.check(pkt_name, key_name));
+}
+
+BOOST_AUTO_TEST_CASE(Explain) {
+  tlv::bstring_view buf(Schema1::binary, sizeof(Schema1::binary));
+
+  auto model = lvs::LvsModel::Parse(buf);
+  BOOST_CHECK(model.has_value());
+
+  auto checker = lvs::Checker(*model, {});
+  using Event = lvs::ExplainEvent;
+  auto count = [](const lvs::Explanation& explanation, Event::Kind kind) {
+    return std::count_if(explanation.events.begin(), explanation.events.end(),
+                         [kind](const Event& e) { return e.kind == kind; });
+  };
+
+  auto accepted = checker.explain("/a/b/c", "/xxx/yyy/zzz");
+  BOOST_CHECK(accepted.result);
+  BOOST_CHECK_EQUAL(accepted.dropped, 0);
+  BOOST_REQUIRE(!accepted.events.empty());
+  BOOST_CHECK_EQUAL(accepted.events.back().kind, Event::SIGN_CONS);
+  BOOST_CHECK(accepted.events.back().ok);
+  BOOST_CHECK(accepted.events.back().key);
+
+  // "q" passes the edge of #r1 without constraint on a, but "q" is not "b" or "y"
+  auto rejected = checker.explain("/q/q/c", "/xxx/yyy/zzz");
+  BOOST_CHECK(!rejected.result);
+  BOOST_CHECK_GT(count(rejected, Event::CONSTRAINT_FAILED), 0);
+  BOOST_CHECK_EQUAL(count(rejected, Event::MATCH), 0);
+  BOOST_CHECK_EQUAL(count(rejected, Event::SIGN_CONS), 0);
+  auto text = rejected.to_string();
+  BOOST_CHECK(text.find("rejected") != std::string::npos);
+  BOOST_CHECK(text.find("failed constraint 0") != std::string::npos);
+
+  // The key matches #r2 and #r3, whose nodes #r1 does not allow here
+  auto wrong_key = checker.explain("/a/b/c", "/yyy/xxx/zzz");
+  BOOST_CHECK(!wrong_key.result);
+  BOOST_CHECK_GT(count(wrong_key, Event::MATCH), 0);
+
+  auto bounded = checker.explain("/q/q/c", "/xxx/yyy/zzz", 2);
+  BOOST_CHECK_EQUAL(bounded.events.size(), 2);
+  BOOST_CHECK_EQUAL(bounded.dropped, rejected.events.size() - 2);
+  BOOST_CHECK(bounded.to_string().find("more events") != std::string::npos);
+
+  // Explaining does not change the result
+  BOOST_CHECK_EQUAL(checker.check("/q/q/c", "/xxx/yyy/zzz"), rejected.result);
+}
+
+BOOST_AUTO_TEST_CASE(ConstraintOptionOrder) {
+  tlv::bstring_view buf(Schema1::binary, sizeof(Schema1::binary));
+
+  auto model = lvs::LvsModel::Parse(buf);
+  BOOST_CHECK(model.has_value());
+
+  // Give the edge of #r1 without constraint the sets {$log, "q"} and {"r"}
+  static const std::uint8_t q[] = {0x08, 0x01, 'q'};
+  static const std::uint8_t r[] = {0x08, 0x01, 'r'};
+  lvs::ConstraintOption log_option, q_option, r_option;
+  log_option.fn = lvs::UserFnCall{"$log", {}};
+  q_option.value = tlv::bstring_view(q, sizeof(q));
+  r_option.value = tlv::bstring_view(r, sizeof(r));
+  auto& edge = model->nodes[model->start_id].p_edges[1];
+  BOOST_REQUIRE(edge.cons_sets.empty());
+  edge.cons_sets = {lvs::PatternConstraint{{log_option, q_option}}, lvs::PatternConstraint{{r_option}}};
+
+  auto calls = std::vector<ndn::Name::Component>();
+  auto checker = lvs::Checker(*model, {{"$log", [&](auto value, auto&) {
+    calls.push_back(value);
+    return false;
+  }}});
+
+  // The user function comes before the literal in the schema, so it runs even though "q" matches
+  auto explanation = checker.explain("/q/b/c", "/xxx/yyy/zzz");
+  BOOST_CHECK(!explanation.result);
+  BOOST_CHECK_EQUAL(calls.size(), 1);
+  BOOST_CHECK_EQUAL(calls.at(0), ndn::Name::Component("q"));
+  auto failed = std::find_if(explanation.events.begin(), explanation.events.end(), [](auto& e) {
+    return e.kind == lvs::ExplainEvent::CONSTRAINT_FAILED && e.edge == 1;
+  });
+  BOOST_REQUIRE(failed != explanation.events.end());
+  BOOST_CHECK_EQUAL(failed->constraint, 1);
+
+  // After a matching literal, no more options are tried
+  edge.cons_sets = {lvs::PatternConstraint{{q_option, log_option}}};
+  calls.clear();
+  auto checker2 = lvs::Checker(*model, {{"$log", [&](auto value, auto&) {
+    calls.push_back(value);
+    return false;
+  }}});
+  BOOST_CHECK(checker2.check("/q/b/c", "/xxx/yyy/zzz"));
+  BOOST_CHECK(calls.empty());
+}
+
+BOOST_AUTO_TEST_CASE(Analyze) {
+  auto model1 = lvs::LvsModel::Parse(tlv::bstring_view(Schema1::binary, sizeof(Schema1::binary)));
+  auto report1 = lvs::Checker(*model1, {}).analyze();
+  BOOST_CHECK_EQUAL(report1.max_depth, 3);
+  BOOST_CHECK(report1.ambiguous_nodes == std::vector<uint64_t>{0});
+  BOOST_CHECK(!report1.super_linear);
+  BOOST_CHECK_EQUAL(report1.worst_visits, 10);
+
+  auto model2 = lvs::LvsModel::Parse(tlv::bstring_view(Schema2::binary, sizeof(Schema2::binary)));
+  auto report2 = lvs::Checker(*model2, {}).analyze();
+  BOOST_CHECK_EQUAL(report2.max_depth, 6);
+  BOOST_CHECK(report2.ambiguous_nodes == std::vector<uint64_t>{1});
+  BOOST_CHECK(!report2.super_linear);
+}
+
 BOOST_AUTO_TEST_SUITE_END() // TestLvs
 
 } // namespace tests
\ No newline at end of file
@@ -0,0 +1,515 @@
+// lvs-codegen compiles a binary LVS trust schema into a C++ header.
+// The header holds the model as constexpr data, plus one specialized matcher per node
+// with literal comparisons, edges and sign_cons checks unrolled into straight-line code.
+// Use it through lvs::CompiledChecker<Schema>, which has the same interface as lvs::Checker.
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <boost/program_options.hpp>
+
+#include "lvs-binary.hpp"
+
+namespace lvs {
+namespace codegen {
+
+namespace po = boost::program_options;
+
+struct CodegenError: std::exception {
+  std::string msg;
+  CodegenError(const std::string& msg): msg(msg) {}
+  const char* what() const noexcept override {
+    return msg.c_str();
+  }
+};
+
+class Generator {
+public:
+  Generator(const LvsModel& model, const std::string& source_name):
+    model(model), source_name(source_name)
+  {
+    Verify();
+    for(auto&& node: model.nodes) {
+      for(auto&& ve: node.v_edges) {
+        AddLiteral(ve.value);
+      }
+      for(auto&& pe: node.p_edges) {
+        for(auto&& cons: pe.cons_sets) {
+          for(auto&& option: cons.options) {
+            if(option.value.has_value()) {
+              AddLiteral(*option.value);
+            }
+            if(option.fn.has_value()) {
+              for(auto&& arg: option.fn->args) {
+                if(arg.value.has_value()) {
+                  AddLiteral(*arg.value);
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  void
+  emit(std::ostream& os, const std::string& ns, const std::string& cls,
+       const std::string& include, const tlv::bstring_view& binary)
+  {
+    os << "// Generated by lvs-codegen from " << source_name << ". Do not edit.\n"
+       << "#pragma once\n\n"
+       << "#include <" << include << ">\n\n"
+       << "namespace " << ns << " {\n\n";
+
+    EmitDeclaration(os, cls, binary);
+    for(auto&& node: model.nodes) {
+      EmitNode(os, cls, node);
+    }
+    EmitMatch(os, cls);
+    EmitSignedBy(os, cls);
+    EmitRuleName(os, cls);
+
+    os << "using Checker = lvs::CompiledChecker<" << cls << ">;\n\n"
+       << "} // namespace " << ns << "\n";
+  }
+
+private:
+  struct Literal {
+    std::string id;
+    uint64_t type;
+    size_t header_size;
+    size_t length;
+  };
+
+  void
+  Verify()
+  {
+    auto node_cnt = model.nodes.size();
+    if(model.start_id >= node_cnt) {
+      throw CodegenError("Start node does not exist");
+    }
+    for(size_t i = 0; i < node_cnt; i ++) {
+      auto&& node = model.nodes[i];
+      if(node.id != i) {
+        throw CodegenError("Node IDs must be consecutive and in order");
+      }
+      if(node.parent.has_value() && *node.parent >= node_cnt) {
+        throw CodegenError("Parent of node " + std::to_string(i) + " does not exist");
+      }
+      for(auto&& ve: node.v_edges) {
+        if(ve.dest >= node_cnt) {
+          throw CodegenError("Edge destination " + std::to_string(ve.dest) + " does not exist");
+        }
+      }
+      for(auto&& pe: node.p_edges) {
+        if(pe.dest >= node_cnt) {
+          throw CodegenError("Edge destination " + std::to_string(pe.dest) + " does not exist");
+        }
+        for(auto&& cons: pe.cons_sets) {
+          for(auto&& option: cons.options) {
+            if(option.tag.has_value() && *option.tag > model.named_pattern_cnt) {
+              throw CodegenError("Constraint refers to unnamed pattern " + std::to_string(*option.tag));
+            }
+            if(!option.value.has_value() && !option.tag.has_value() && !option.fn.has_value()) {
+              throw CodegenError("Empty constraint option on node " + std::to_string(i));
+            }
+          }
+        }
+      }
+      for(auto&& key_node: node.sign_cons) {
+        if(key_node >= node_cnt) {
+          throw CodegenError("Signing constraint " + std::to_string(key_node) + " does not exist");
+        }
+      }
+    }
+  }
+
+  void
+  AddLiteral(const tlv::NameComponent& value)
+  {
+    auto key = std::string(value.begin(), value.end());
+    if(literals.count(key)) {
+      return;
+    }
+    auto [type, tsiz] = tlv::TlvVar::Parse(value);
+    if(!type.has_value()) {
+      throw CodegenError("Malformed name component literal");
+    }
+    auto [length, lsiz] = tlv::TlvVar::Parse(value.substr(tsiz));
+    if(!length.has_value() || tsiz + lsiz + *length != value.size()) {
+      throw CodegenError("Malformed name component literal");
+    }
+    literals[key] = Literal{"lit_" + std::to_string(literal_order.size()), *type, tsiz + lsiz, *length};
+    literal_order.push_back(key);
+  }
+
+  const Literal&
+  GetLiteral(const tlv::NameComponent& value)
+  {
+    return literals.at(std::string(value.begin(), value.end()));
+  }
+
+  static void
+  EmitBytes(std::ostream& os, const std::string& bytes, const std::string& indent)
+  {
+    os << indent;
+    for(size_t i = 0; i < bytes.size(); i ++) {
+      char buf[8];
+      std::snprintf(buf, sizeof(buf), "0x%02X,", uint8_t(bytes[i]));
+      os << buf;
+      if(i + 1 == bytes.size()) {
+        break;
+      }
+      os << ((i % 16 == 15) ? "\n" + indent : " ");
+    }
+    os << "\n";
+  }
+
+  static std::string
+  Quote(const std::string& str)
+  {
+    std::ostringstream os;
+    os << '"';
+    for(auto c: str) {
+      if(c == '"' || c == '\\') {
+        os << '\\' << c;
+      } else if(uint8_t(c) < 0x20 || uint8_t(c) >= 0x7f) {
+        char buf[8];
+        std::snprintf(buf, sizeof(buf), "\\%03o", uint8_t(c));
+        os << buf;
+      } else {
+        os << c;
+      }
+    }
+    os << '"';
+    return os.str();
+  }
+
+  void
+  EmitDeclaration(std::ostream& os, const std::string& cls, const tlv::bstring_view& binary)
+  {
+    auto symbols = std::vector<std::string>(model.named_pattern_cnt + 1);
+    for(auto&& sym: model.symbols) {
+      if(sym.tag < symbols.size()) {
+        symbols[sym.tag] = sym.ident;
+      }
+    }
+
+    os << "struct " << cls << " {\n"
+       << "  using Context = lvs::compiled::Context;\n"
+       << "  using UserFns = lvs::compiled::UserFns;\n"
+       << "  using Visitor = lvs::compiled::Visitor;\n\n"
+       << "  static constexpr uint64_t version = " << model.version << "u;\n"
+       << "  static constexpr uint64_t start_id = " << model.start_id << "u;\n"
+       << "  static constexpr uint64_t named_pattern_cnt = " << model.named_pattern_cnt << "u;\n"
+       << "  static constexpr size_t node_cnt = " << model.nodes.size() << "u;\n\n";
+
+    os << "  // The binary LVS model this header was generated from.\n"
+       << "  static constexpr uint8_t binary[] = {\n";
+    EmitBytes(os, std::string(binary.begin(), binary.end()), "    ");
+    os << "  };\n\n";
+
+    os << "  // Parent of each node, or -1 for the root.\n"
+       << "  static constexpr int64_t parents[] = {";
+    for(auto&& node: model.nodes) {
+      os << (node.id ? ", " : "") << (node.parent.has_value() ? int64_t(*node.parent) : -1);
+    }
+    os << "};\n\n";
+
+    os << "  // Pattern identifiers indexed by tag.\n"
+       << "  static constexpr std::string_view symbols[] = {";
+    for(size_t i = 0; i < symbols.size(); i ++) {
+      os << (i ? ", " : "") << Quote(symbols[i]);
+    }
+    os << "};\n\n";
+
+    os << "  // Name component literals, in TLV wire format.\n";
+    for(auto&& bytes: literal_order) {
+      os << "  static constexpr uint8_t " << literals[bytes].id << "[] = {";
+      for(size_t i = 0; i < bytes.size(); i ++) {
+        char buf[8];
+        std::snprintf(buf, sizeof(buf), "0x%02X", uint8_t(bytes[i]));
+        os << (i ? ", " : "") << buf;
+      }
+      os << "};\n";
+    }
+    os << "\n";
+
+    os << "  static bool\n"
+       << "  Match(const ndn::Name& name, Context& con, const UserFns& fns, Visitor visit);\n\n"
+       << "  static bool\n"
+       << "  SignedBy(uint64_t pkt_node, uint64_t key_node);\n\n"
+       << "  static const std::vector<std::string>&\n"
+       << "  RuleName(uint64_t node_id);\n\n"
+       << "  template<uint64_t N>\n"
+       << "  static bool\n"
+       << "  Node(const ndn::Name& name, size_t depth, Context& con, const UserFns& fns, Visitor visit);\n"
+       << "};\n\n";
+
+    for(auto&& node: model.nodes) {
+      os << "template<>\n"
+         << "inline bool\n"
+         << cls << "::Node<" << node.id << ">(const ndn::Name& name, size_t depth, Context& con, "
+         << "const UserFns& fns, Visitor visit);\n";
+    }
+    os << "\n";
+  }
+
+  std::string
+  LiteralMatch(const tlv::NameComponent& value)
+  {
+    auto&& lit = GetLiteral(value);
+    std::ostringstream os;
+    os << "lvs::compiled::LiteralEquals(value, " << lit.type << ", "
+       << lit.id << " + " << lit.header_size << ", " << lit.length << ")";
+    return os.str();
+  }
+
+  std::string
+  OptionMatch(const ConstraintOption& option)
+  {
+    if(option.value.has_value()) {
+      return LiteralMatch(*option.value);
+    } else if(option.tag.has_value()) {
+      return "lvs::compiled::TagEquals(value, con, " + std::to_string(*option.tag) + ")";
+    }
+    std::ostringstream os;
+    os << "lvs::compiled::CallUserFn(fns, " << Quote(option.fn->fn_id) << ", value, {";
+    for(size_t i = 0; i < option.fn->args.size(); i ++) {
+      auto&& arg = option.fn->args[i];
+      os << (i ? ", " : "");
+      if(arg.value.has_value()) {
+        auto&& lit = GetLiteral(*arg.value);
+        os << "ndn::Name::Component(ndn::Block(" << lit.id << ", sizeof(" << lit.id << ")))";
+      } else {
+        os << "lvs::compiled::TagOrEmpty(con, " << arg.tag.value_or(0) << ")";
+      }
+    }
+    os << "})";
+    return os.str();
+  }
+
+  // Constraint sets are AND-ed; options within one set are OR-ed.
+  std::string
+  ConstraintsMatch(const std::vector<PatternConstraint>& cons_sets)
+  {
+    std::ostringstream os;
+    for(size_t i = 0; i < cons_sets.size(); i ++) {
+      auto&& options = cons_sets[i].options;
+      os << (i ? "\n       && " : "") << "(";
+      if(options.empty()) {
+        os << "false";
+      }
+      for(size_t j = 0; j < options.size(); j ++) {
+        os << (j ? "\n           || " : "") << OptionMatch(options[j]);
+      }
+      os << ")";
+    }
+    return os.str();
+  }
+
+  void
+  EmitNode(std::ostream& os, const std::string& cls, const Node& node)
+  {
+    auto next = [](uint64_t dest) {
+      return "Node<" + std::to_string(dest) + ">(name, depth + 1, con, fns, visit)";
+    };
+
+    os << "template<>\n"
+       << "inline bool\n"
+       << cls << "::Node<" << node.id << ">(const ndn::Name& name, size_t depth, Context& con, "
+       << "[[maybe_unused]] const UserFns& fns, Visitor visit)\n"
+       << "{\n"
+       << "  if(depth == name.size()) {\n"
+       << "    return visit(" << node.id << ", con);\n"
+       << "  }\n";
+    if(node.v_edges.empty() && node.p_edges.empty()) {
+      os << "  return false;\n"
+         << "}\n\n";
+      return;
+    }
+    os << "  [[maybe_unused]] const auto& value = name[depth];\n";
+
+    // A value edge matches at most once, so literals form an else-if chain
+    for(size_t i = 0; i < node.v_edges.size(); i ++) {
+      auto&& ve = node.v_edges[i];
+      os << (i ? " else if(" : "  if(") << LiteralMatch(ve.value) << ") {\n"
+         << "    if(" << next(ve.dest) << ") {\n"
+         << "      return true;\n"
+         << "    }\n"
+         << "  }";
+    }
+    if(!node.v_edges.empty()) {
+      os << "\n";
+    }
+
+    for(auto&& pe: node.p_edges) {
+      auto cons = ConstraintsMatch(pe.cons_sets);
+      if(pe.tag <= model.named_pattern_cnt) {
+        os << "  if(con[" << pe.tag << "].has_value()) {\n"
+           << "    if(value == *con[" << pe.tag << "] && " << next(pe.dest) << ") {\n"
+           << "      return true;\n"
+           << "    }\n"
+           << "  } else" << (cons.empty() ? " {\n" : " if(" + cons + ") {\n")
+           << "    con[" << pe.tag << "] = value;\n"
+           << "    if(" << next(pe.dest) << ") {\n"
+           << "      return true;\n"
+           << "    }\n"
+           << "    con[" << pe.tag << "] = std::nullopt;\n"
+           << "  }\n";
+      } else if(cons.empty()) {
+        os << "  if(" << next(pe.dest) << ") {\n"
+           << "    return true;\n"
+           << "  }\n";
+      } else {
+        os << "  if(" << cons << ") {\n"
+           << "    if(" << next(pe.dest) << ") {\n"
+           << "      return true;\n"
+           << "    }\n"
+           << "  }\n";
+      }
+    }
+    os << "  return false;\n"
+       << "}\n\n";
+  }
+
+  void
+  EmitMatch(std::ostream& os, const std::string& cls)
+  {
+    os << "inline bool\n"
+       << cls << "::Match(const ndn::Name& name, Context& con, const UserFns& fns, Visitor visit)\n"
+       << "{\n"
+       << "  return Node<" << model.start_id << ">(name, 0, con, fns, visit);\n"
+       << "}\n\n";
+  }
+
+  void
+  EmitSignedBy(std::ostream& os, const std::string& cls)
+  {
+    os << "inline bool\n"
+       << cls << "::SignedBy(uint64_t pkt_node, uint64_t key_node)\n"
+       << "{\n"
+       << "  switch(pkt_node) {\n";
+    for(auto&& node: model.nodes) {
+      if(node.sign_cons.empty()) {
+        continue;
+      }
+      os << "  case " << node.id << ":\n"
+         << "    return ";
+      for(size_t i = 0; i < node.sign_cons.size(); i ++) {
+        os << (i ? " || " : "") << "key_node == " << node.sign_cons[i];
+      }
+      os << ";\n";
+    }
+    os << "  default:\n"
+       << "    return false;\n"
+       << "  }\n"
+       << "}\n\n";
+  }
+
+  void
+  EmitRuleName(std::ostream& os, const std::string& cls)
+  {
+    os << "inline const std::vector<std::string>&\n"
+       << cls << "::RuleName(uint64_t node_id)\n"
+       << "{\n"
+       << "  static const std::vector<std::string> rule_names[] = {\n";
+    for(auto&& node: model.nodes) {
+      os << "    {";
+      for(size_t i = 0; i < node.rule_name.size(); i ++) {
+        os << (i ? ", " : "") << Quote(node.rule_name[i]);
+      }
+      os << "},\n";
+    }
+    os << "  };\n"
+       << "  return rule_names[node_id];\n"
+       << "}\n\n";
+  }
+
+private:
+  const LvsModel& model;
+  std::string source_name;
+  std::map<std::string, Literal> literals;
+  std::vector<std::string> literal_order;
+};
+
+static int
+main(int argc, char** argv)
+{
+  std::string input, output, ns, cls, include;
+
+  po::options_description description(
+    "Usage: lvs-codegen [options] <input.lvs> <output.hpp>\n"
+    "\n"
+    "Options");
+  description.add_options()
+    ("help,h", "print this help message and exit")
+    ("namespace,n", po::value<std::string>(&ns)->default_value("lvs::generated"),
+     "namespace of the generated code")
+    ("class,c", po::value<std::string>(&cls)->default_value("Schema"),
+     "name of the generated schema struct")
+    ("include,I", po::value<std::string>(&include)->default_value("lvs-cxx/lvs-compiled.hpp"),
+     "path used to include lvs-compiled.hpp")
+    ("input", po::value<std::string>(&input), "binary LVS trust schema")
+    ("output", po::value<std::string>(&output), "generated C++ header");
+
+  po::positional_options_description pos;
+  pos.add("input", 1).add("output", 1);
+
+  po::variables_map vm;
+  try {
+    po::store(po::command_line_parser(argc, argv).options(description).positional(pos).run(), vm);
+    po::notify(vm);
+  }
+  catch (const po::error& e) {
+    std::cerr << "ERROR: " << e.what() << "\n\n" << description << std::endl;
+    return 2;
+  }
+  if(vm.count("help") || input.empty() || output.empty()) {
+    std::cout << description << std::endl;
+    return vm.count("help") ? 0 : 2;
+  }
+
+  std::ifstream file(input, std::ios::binary);
+  if(!file) {
+    std::cerr << "ERROR: cannot open " << input << std::endl;
+    return 1;
+  }
+  auto wire = std::vector<uint8_t>(std::istreambuf_iterator<char>(file), {});
+  auto binary = tlv::bstring_view(wire.data(), wire.size());
+  auto model = LvsModel::Parse(binary);
+  if(!model.has_value()) {
+    std::cerr << "ERROR: failed to parse LVS trust schema " << input << std::endl;
+    return 1;
+  }
+
+  std::ostringstream os;
+  try {
+    auto source_name = input.substr(input.find_last_of('/') + 1);
+    Generator(*model, source_name).emit(os, ns, cls, include, binary);
+  }
+  catch (const CodegenError& e) {
+    std::cerr << "ERROR: " << input << ": " << e.what() << std::endl;
+    return 1;
+  }
+
+  std::ofstream out(output);
+  out << os.str();
+  if(!out) {
+    std::cerr << "ERROR: cannot write " << output << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+} // namespace codegen
+} // namespace lvs
+
+int
+main(int argc, char** argv)
+{
+  return lvs::codegen::main(argc, argv);
+}
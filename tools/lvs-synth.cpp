@@ -0,0 +1,511 @@
+// lvs-synth generates a synthetic binary LVS trust schema and a trace of names checked against it,
+// so that the scaling of Checker can be measured on schemas far larger than hand-written ones.
+// The schema is a tree whose shape is set by depth, fan-out, the ratio of pattern to literal edges,
+// the density of constraints and of sign_cons. The same seed always gives the same output.
+//
+// Each line of the trace is "<packet name>\t<key name>\t<1|0>", where the last column is whether
+// Checker::check accepts the pair. Accepted pairs follow a rule and one of its signers; rejected
+// ones are near misses: a key of another rule, a mutated key component, or a packet name too long.
+
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <boost/program_options.hpp>
+
+#include "lvs-binary.hpp"
+#include "lvs-checker.hpp"
+
+namespace lvs {
+namespace synth {
+
+namespace po = boost::program_options;
+using Bytes = std::basic_string<std::uint8_t>;
+
+struct Params {
+  size_t depth;
+  size_t fanout;
+  size_t max_nodes;
+  double pattern_ratio;
+  double named_ratio;
+  double constraint_density;
+  double sign_density;
+  size_t max_signers;
+  size_t pairs;
+  double miss_ratio;
+  uint64_t seed;
+};
+
+// Tree edge into a node. Literal edges take one value; pattern edges take any value that
+// passes the constraint, made of literal options and at most one option naming an earlier tag.
+struct Edge {
+  bool pattern = false;
+  std::string literal;
+  uint64_t tag = 0;
+  bool constrained = false;
+  std::vector<std::string> options;
+  std::optional<uint64_t> tag_option;
+};
+
+struct SynthNode {
+  std::optional<uint64_t> parent;
+  size_t depth = 0;
+  Edge in_edge;
+  std::vector<uint64_t> children;
+  std::vector<uint64_t> named_tags;  // Named tags bound on the path to this node
+  std::string rule;
+  std::vector<uint64_t> sign_cons;
+};
+
+// The TLV encoding of LvsModel. lvs-binary.hpp only parses it.
+class Encoder {
+public:
+  static void
+  AppendVarNum(Bytes& buf, uint64_t value)
+  {
+    if(value < 253) {
+      buf.push_back(uint8_t(value));
+    } else if(value <= 0xFFFF) {
+      buf.push_back(253);
+      AppendBigEndian(buf, value, 2);
+    } else if(value <= 0xFFFFFFFF) {
+      buf.push_back(254);
+      AppendBigEndian(buf, value, 4);
+    } else {
+      buf.push_back(255);
+      AppendBigEndian(buf, value, 8);
+    }
+  }
+
+  static void
+  AppendBlock(Bytes& buf, uint64_t type, const Bytes& value)
+  {
+    AppendVarNum(buf, type);
+    AppendVarNum(buf, value.size());
+    buf += value;
+  }
+
+  static void
+  AppendNatural(Bytes& buf, uint64_t type, uint64_t value)
+  {
+    auto bytes = Bytes();
+    AppendBigEndian(bytes, value, value <= 0xFF ? 1 : value <= 0xFFFF ? 2 : value <= 0xFFFFFFFF ? 4 : 8);
+    AppendBlock(buf, type, bytes);
+  }
+
+  static void
+  AppendString(Bytes& buf, uint64_t type, const std::string& value)
+  {
+    AppendBlock(buf, type, Bytes(value.begin(), value.end()));
+  }
+
+  // A generic name component, in the full TLV form used by LVS
+  static void
+  AppendComponent(Bytes& buf, uint64_t type, const std::string& value)
+  {
+    auto component = Bytes();
+    AppendString(component, ndn::tlv::GenericNameComponent, value);
+    AppendBlock(buf, type, component);
+  }
+
+private:
+  static void
+  AppendBigEndian(Bytes& buf, uint64_t value, int size)
+  {
+    for(int i = size - 1; i >= 0; i --) {
+      buf.push_back(uint8_t(value >> (8 * i)));
+    }
+  }
+};
+
+class Synthesizer {
+public:
+  Synthesizer(const Params& params):
+    params(params), rng(params.seed)
+  {
+    Grow();
+    AssignRules();
+  }
+
+  Bytes
+  encode() const
+  {
+    auto wire = Bytes();
+    Encoder::AppendNatural(wire, type::VERSION, 0x00010000);
+    Encoder::AppendNatural(wire, type::NODE_ID, 0);
+    Encoder::AppendNatural(wire, type::NAMED_PATTERN_NUM, params.depth);
+    for(size_t id = 0; id < nodes.size(); id ++) {
+      auto&& node = nodes[id];
+      auto value = Bytes();
+      Encoder::AppendNatural(value, type::NODE_ID, id);
+      if(node.parent.has_value()) {
+        Encoder::AppendNatural(value, type::PARENT_ID, *node.parent);
+      }
+      if(!node.rule.empty()) {
+        Encoder::AppendString(value, type::IDENTIFIER, node.rule);
+      }
+      for(auto child: node.children) {
+        auto&& edge = nodes[child].in_edge;
+        if(edge.pattern) {
+          continue;
+        }
+        auto ve = Bytes();
+        Encoder::AppendNatural(ve, type::NODE_ID, child);
+        Encoder::AppendComponent(ve, type::COMPONENT_VALUE, edge.literal);
+        Encoder::AppendBlock(value, type::VALUE_EDGE, ve);
+      }
+      for(auto child: node.children) {
+        auto&& edge = nodes[child].in_edge;
+        if(!edge.pattern) {
+          continue;
+        }
+        auto pe = Bytes();
+        Encoder::AppendNatural(pe, type::NODE_ID, child);
+        Encoder::AppendNatural(pe, type::PATTERN_TAG, edge.tag);
+        if(edge.constrained) {
+          auto cons = Bytes();
+          for(auto&& literal: edge.options) {
+            auto option = Bytes();
+            Encoder::AppendComponent(option, type::COMPONENT_VALUE, literal);
+            Encoder::AppendBlock(cons, type::CONS_OPTION, option);
+          }
+          if(edge.tag_option.has_value()) {
+            auto option = Bytes();
+            Encoder::AppendNatural(option, type::PATTERN_TAG, *edge.tag_option);
+            Encoder::AppendBlock(cons, type::CONS_OPTION, option);
+          }
+          Encoder::AppendBlock(pe, type::CONSTRAINT, cons);
+        }
+        Encoder::AppendBlock(value, type::PATTERN_EDGE, pe);
+      }
+      for(auto key: node.sign_cons) {
+        Encoder::AppendNatural(value, type::KEY_NODE_ID, key);
+      }
+      Encoder::AppendBlock(wire, type::NODE, value);
+    }
+    for(uint64_t tag = 1; tag <= params.depth; tag ++) {
+      auto value = Bytes();
+      Encoder::AppendNatural(value, type::PATTERN_TAG, tag);
+      Encoder::AppendString(value, type::IDENTIFIER, "t" + std::to_string(tag));
+      Encoder::AppendBlock(wire, type::TAG_SYMBOL, value);
+    }
+    return wire;
+  }
+
+  // Writes params.pairs lines, labeled by checker, which must have been built from encode()
+  void
+  writeTrace(std::ostream& os, Checker& checker)
+  {
+    size_t misses = size_t(params.pairs * params.miss_ratio);
+    size_t hits = params.pairs - misses;
+    if(leaves.empty()) {
+      throw LvsModelError("The schema has no rule; raise --max-nodes");
+    }
+    if(hits > 0 && signed_rules.empty()) {
+      throw LvsModelError("No rule has a signer; raise --sign-density");
+    }
+    for(size_t i = 0; i < hits; i ++) {
+      auto [pkt, key] = MakeHit();
+      if(!checker.check(pkt, key)) {
+        throw LvsModelError("Generated pair is rejected: " + pkt.toUri() + " " + key.toUri());
+      }
+      os << pkt.toUri() << "\t" << key.toUri() << "\t1\n";
+    }
+    size_t attempts = 0;
+    for(size_t i = 0; i < misses; ) {
+      if(++ attempts > 100 * misses) {
+        throw LvsModelError("The schema accepts almost every name; cannot generate rejected pairs");
+      }
+      auto [pkt, key] = MakeMiss();
+      if(checker.check(pkt, key)) {
+        continue;
+      }
+      os << pkt.toUri() << "\t" << key.toUri() << "\t0\n";
+      i ++;
+    }
+  }
+
+  size_t
+  size() const
+  {
+    return nodes.size();
+  }
+
+private:
+  using Bindings = std::map<uint64_t, ndn::Name::Component>;
+
+  // std::*_distribution differ between standard libraries; these do not
+  size_t
+  Uniform(size_t n)
+  {
+    return size_t(rng() % n);
+  }
+
+  bool
+  Chance(double p)
+  {
+    return double(rng() >> 11) * 0x1.0p-53 < p;
+  }
+
+  // Breadth-first, so that a node limit cuts the tree evenly
+  void
+  Grow()
+  {
+    nodes.push_back(SynthNode{});
+    for(size_t id = 0; id < nodes.size() && nodes.size() < params.max_nodes; id ++) {
+      if(nodes[id].depth >= params.depth) {
+        continue;
+      }
+      for(size_t i = 0; i < params.fanout && nodes.size() < params.max_nodes; i ++) {
+        auto child = SynthNode{};
+        child.parent = id;
+        child.depth = nodes[id].depth + 1;
+        child.named_tags = nodes[id].named_tags;
+        child.in_edge = MakeEdge(nodes[id], i);
+        if(child.in_edge.pattern && child.in_edge.tag <= params.depth) {
+          child.named_tags.push_back(child.in_edge.tag);
+        }
+        nodes[id].children.push_back(nodes.size());
+        nodes.push_back(std::move(child));
+      }
+    }
+  }
+
+  Edge
+  MakeEdge(const SynthNode& parent, size_t index)
+  {
+    auto edge = Edge{};
+    if(!Chance(params.pattern_ratio)) {
+      edge.literal = "c" + std::to_string(parent.depth) + "_" + std::to_string(index);
+      return edge;
+    }
+    edge.pattern = true;
+    // A named tag per depth, so that one path never binds a tag twice.
+    // Tags above depth are anonymous and match anything.
+    edge.tag = Chance(params.named_ratio) ? parent.depth + 1 : params.depth + 1;
+    if(Chance(params.constraint_density)) {
+      edge.constrained = true;
+      for(size_t i = 0, n = 1 + Uniform(3); i < n; i ++) {
+        edge.options.push_back("v" + std::to_string(i));
+      }
+      if(!parent.named_tags.empty() && Chance(0.5)) {
+        edge.tag_option = parent.named_tags[Uniform(parent.named_tags.size())];
+      }
+    }
+    return edge;
+  }
+
+  void
+  AssignRules()
+  {
+    for(size_t id = 1; id < nodes.size(); id ++) {
+      if(nodes[id].children.empty()) {
+        nodes[id].rule = "#r" + std::to_string(id);
+        leaves.push_back(id);
+      }
+    }
+    for(auto id: leaves) {
+      if(!Chance(params.sign_density)) {
+        continue;
+      }
+      for(size_t i = 0, n = 1 + Uniform(params.max_signers); i < n; i ++) {
+        nodes[id].sign_cons.push_back(leaves[Uniform(leaves.size())]);
+      }
+      signed_rules.push_back(id);
+    }
+  }
+
+  // A name of the rule at node_id, reusing the values of tags already bound
+  ndn::Name
+  MakeName(uint64_t node_id, Bindings& bindings)
+  {
+    auto path = std::vector<uint64_t>();
+    for(auto cur = node_id; nodes[cur].parent.has_value(); cur = *nodes[cur].parent) {
+      path.push_back(cur);
+    }
+    auto name = ndn::Name();
+    for(auto it = path.rbegin(); it != path.rend(); it ++) {
+      auto&& edge = nodes[*it].in_edge;
+      if(!edge.pattern) {
+        name.append(ndn::Name::Component(edge.literal));
+        continue;
+      }
+      auto bound = bindings.find(edge.tag);
+      if(bound != bindings.end()) {
+        name.append(bound->second);
+        continue;
+      }
+      auto value = ndn::Name::Component();
+      if(!edge.constrained) {
+        value = ndn::Name::Component("x" + std::to_string(Uniform(1000000)));
+      } else if(!edge.options.empty()) {
+        value = ndn::Name::Component(edge.options[Uniform(edge.options.size())]);
+      } else {
+        value = bindings.at(*edge.tag_option);
+      }
+      if(edge.tag <= params.depth) {
+        bindings[edge.tag] = value;
+      }
+      name.append(value);
+    }
+    return name;
+  }
+
+  std::pair<ndn::Name, ndn::Name>
+  MakeHit()
+  {
+    auto pkt_node = signed_rules[Uniform(signed_rules.size())];
+    auto&& signers = nodes[pkt_node].sign_cons;
+    auto bindings = Bindings();
+    auto pkt = MakeName(pkt_node, bindings);
+    auto key = MakeName(signers[Uniform(signers.size())], bindings);
+    return {pkt, key};
+  }
+
+  std::pair<ndn::Name, ndn::Name>
+  MakeMiss()
+  {
+    auto bindings = Bindings();
+    switch(Uniform(3)) {
+    case 0: {
+      // A key of a random rule
+      auto pkt = MakeName(leaves[Uniform(leaves.size())], bindings);
+      auto key = MakeName(leaves[Uniform(leaves.size())], bindings);
+      return {pkt, key};
+    }
+    case 1: {
+      // A signer with one component changed
+      auto [pkt, key] = signed_rules.empty() ? MakeMissBase(bindings) : MakeHit();
+      if(!key.empty()) {
+        auto pos = Uniform(key.size());
+        key = key.getPrefix(pos).append(ndn::Name::Component("zz" + std::to_string(Uniform(1000000)))).append(key.getSubName(pos + 1));
+      }
+      return {pkt, key};
+    }
+    default: {
+      // Longer than any rule
+      auto [pkt, key] = MakeMissBase(bindings);
+      return {pkt.append(ndn::Name::Component("tail")), key};
+    }
+    }
+  }
+
+  std::pair<ndn::Name, ndn::Name>
+  MakeMissBase(Bindings& bindings)
+  {
+    auto pkt = MakeName(leaves[Uniform(leaves.size())], bindings);
+    auto key = MakeName(leaves[Uniform(leaves.size())], bindings);
+    return {pkt, key};
+  }
+
+private:
+  Params params;
+  std::mt19937_64 rng;
+  std::vector<SynthNode> nodes;
+  std::vector<uint64_t> leaves;
+  std::vector<uint64_t> signed_rules;
+};
+
+static int
+main(int argc, char** argv)
+{
+  std::string schema_file, trace_file;
+  Params params;
+
+  po::options_description visible_opts(
+    "Usage: lvs-synth [options] <output.lvs>\n"
+    "\n"
+    "Options");
+  visible_opts.add_options()
+    ("help,h", "print this help message and exit")
+    ("depth,d", po::value<size_t>(&params.depth)->default_value(6), "components of the longest rule")
+    ("fanout,f", po::value<size_t>(&params.fanout)->default_value(4), "children of each inner node")
+    ("max-nodes,n", po::value<size_t>(&params.max_nodes)->default_value(100000), "largest number of nodes")
+    ("pattern-ratio", po::value<double>(&params.pattern_ratio)->default_value(0.3),
+     "fraction of edges that are patterns rather than literals")
+    ("named-ratio", po::value<double>(&params.named_ratio)->default_value(0.5),
+     "fraction of pattern edges that bind a named tag")
+    ("constraint-density", po::value<double>(&params.constraint_density)->default_value(0.3),
+     "fraction of pattern edges with a constraint")
+    ("sign-density", po::value<double>(&params.sign_density)->default_value(0.5),
+     "fraction of rules with sign_cons")
+    ("max-signers", po::value<size_t>(&params.max_signers)->default_value(2), "largest sign_cons of a rule")
+    ("trace,t", po::value<std::string>(&trace_file), "also write a trace of name pairs to this file")
+    ("pairs,p", po::value<size_t>(&params.pairs)->default_value(10000), "name pairs in the trace")
+    ("miss-ratio", po::value<double>(&params.miss_ratio)->default_value(0.5),
+     "fraction of the pairs that are rejected")
+    ("seed,s", po::value<uint64_t>(&params.seed)->default_value(1), "random seed");
+
+  po::options_description hidden_opts;
+  hidden_opts.add_options()
+    ("schema", po::value<std::string>(&schema_file));
+
+  po::positional_options_description pos_opts;
+  pos_opts.add("schema", 1);
+
+  po::options_description all_opts;
+  all_opts.add(visible_opts).add(hidden_opts);
+
+  po::variables_map vm;
+  try {
+    po::store(po::command_line_parser(argc, argv).options(all_opts).positional(pos_opts).run(), vm);
+    po::notify(vm);
+  }
+  catch (const po::error& e) {
+    std::cerr << "ERROR: " << e.what() << "\n\n" << visible_opts << std::endl;
+    return 2;
+  }
+  if(vm.count("help")) {
+    std::cout << visible_opts << std::endl;
+    return 0;
+  }
+  if(schema_file.empty()) {
+    std::cerr << "ERROR: no output file\n\n" << visible_opts << std::endl;
+    return 2;
+  }
+  if(params.depth == 0 || params.fanout == 0 || params.max_signers == 0 ||
+     params.miss_ratio < 0 || params.miss_ratio > 1) {
+    std::cerr << "ERROR: depth, fanout and max-signers must be positive, and miss-ratio in [0, 1]" << std::endl;
+    return 2;
+  }
+
+  try {
+    auto synth = Synthesizer(params);
+    auto wire = synth.encode();
+    std::ofstream os(schema_file, std::ios::binary);
+    os.write(reinterpret_cast<const char*>(wire.data()), wire.size());
+    if(!os) {
+      std::cerr << "ERROR: cannot write " << schema_file << std::endl;
+      return 1;
+    }
+    std::cerr << schema_file << ": " << synth.size() << " nodes, " << wire.size() << " bytes" << std::endl;
+
+    if(!trace_file.empty()) {
+      auto model = LvsModel::Parse(tlv::bstring_view(wire.data(), wire.size()));
+      if(!model.has_value()) {
+        std::cerr << "ERROR: generated schema does not parse" << std::endl;
+        return 1;
+      }
+      auto checker = Checker(*model, {});
+      std::ofstream trace(trace_file);
+      synth.writeTrace(trace, checker);
+      if(!trace) {
+        std::cerr << "ERROR: cannot write " << trace_file << std::endl;
+        return 1;
+      }
+    }
+  }
+  catch (const LvsModelError& e) {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+} // namespace synth
+} // namespace lvs
+
+int
+main(int argc, char** argv)
+{
+  return lvs::synth::main(argc, argv);
+}